@@ -0,0 +1,265 @@
+#ifndef BASIC_CACHE_SIMULATOR_H
+#define BASIC_CACHE_SIMULATOR_H
+
+// Internal to CacheSimulator: the simulator proper, one instantiation per
+// address width. Everything else goes through the CacheSimulator facade.
+
+#include "CacheSimulator.h"
+#include "Cache.h"
+#include "HotBlocks.h"
+#include "IntervalStats.h"
+#include "SharedBlocks.h"
+#include "TraceReader.h"
+
+// What the facade needs of a simulator, independent of the address width
+class SimulatorImpl {
+public:
+    virtual ~SimulatorImpl() {}
+
+    virtual void runSimulation() = 0;
+    virtual void simulate() = 0;
+    virtual int getNumCores() const = 0;
+    virtual CoreStatistics getCoreStatistics(int coreId) const = 0;
+    virtual long long getTotalBusTransactions() const = 0;
+    virtual long long getTotalBusTraffic() const = 0;
+    virtual long long getTotalInvalidations() const = 0;
+    virtual long long getGlobalCycle() const = 0;
+    virtual double getRunSeconds() const = 0;
+    virtual int getAddressBits() const = 0;
+    virtual void printStatistics() = 0;
+    virtual void printPerformance() = 0;
+    virtual void saveCheckpoint(const std::string& path) = 0;
+    virtual void restoreCheckpoint(const std::string& path, bool resetStats) = 0;
+    virtual bool isStopped() const = 0;
+    virtual void printBusStatistics(std::ostream& out) = 0;
+    virtual void printSampleEstimates(std::ostream& out) = 0;
+    virtual void printProfile(std::ostream& out) = 0;
+    virtual const std::vector<SampleUnit>& getSamples() const = 0;
+    virtual const BusTransactionStats& getBusStatistics(BusTransaction transaction) const = 0;
+};
+
+// Address is uint32_t or uint64_t: the width of trace addresses, cache tags
+// and block numbers. Cycles and counters are 64-bit either way.
+template <typename Address>
+class BasicCacheSimulator : public SimulatorImpl {
+private:
+    typedef typename Cache<Address>::Line Line;
+
+    struct CoreState {
+        std::unique_ptr<TraceReader> trace;
+        TraceRecord current;   // next reference to execute
+        bool hasCurrent;
+        bool finished;
+        long long extime;    // execution time counter
+        long long idletime;  // idle time counter
+
+        Cache<Address> cache;   // this core's L1 tag store
+
+        // Statistics
+        long long totalInstructions;
+        long long readCount;
+        long long writeCount;
+        long long missCount;
+        long long hitCount;
+        long long evictionCount;
+        long long writebackCount;
+        long long busInvalidations; // copies of this core's lines invalidated by others
+        long long dataTraffic; // in bytes
+        long long busCycles;   // bus tenure of this core's transactions
+
+        long long readyAt;  // next cycle at which this core can act
+        long long idleFrom; // the idle stretch booked last runs [idleFrom, readyAt)
+        // With intervals: [start, end) windows of bus tenure booked for this
+        // core's transactions that reach past the last interval row
+        std::vector<std::pair<long long, long long> > busWindows;
+        bool missPending;   // current reference missed and is waiting for the bus
+        uint64_t consumed;  // records taken from the trace so far, current included
+
+        CoreState(int coreId, int s, int E, int b, bool withData, bool genericKernels, bool scalarTags,
+                  ReplacementPolicy replacement)
+            : cache(coreId, s, E, b, withData, genericKernels, scalarTags, replacement) {}
+    };
+
+    std::vector<CoreState> cores; // now holds per-core simulation state
+    std::string outFileName;
+    int numCores;
+    long long totalInvalidations;
+    long long totalBusTraffic; // in bytes
+    long long totalBusTransactions;
+    long long globalCycle; //what is this ?
+    bool busFree;
+    long long busNextFree; //bus is next free at this time
+    BusTransaction busTransaction;
+    int busOwner;
+
+    // Split-transaction bus. Each transaction takes one address-bus cycle,
+    // then memory requests queue for one of memorySlotFree.size() slots in
+    // grant order, and data moves in a window reserved on the data bus.
+    bool splitBus;
+    long long addressBusFree;               // next cycle the address bus can be granted
+    std::vector<long long> memorySlotFree;  // cycle at which each memory slot frees up
+    std::map<long long, long long> dataBusBusy; // reserved data bus windows, start -> end
+    bool reportBus;
+    BusTransactionStats busStats[NUM_BUS_TRANSACTIONS];
+    int blockSize;     // Derived from block bits b: blockSize = 2^b
+    EventTracer tracer; // -d / --events
+
+    // Cache configuration
+    int setIndexBits;  // s
+    int associativity; // E
+    int blockBits;     // b
+    int numSets;       // 2^s
+    bool eventDriven;  // engine selection, see SimulatorOptions
+    bool reportPerformance;
+    bool genericKernels;
+    bool scalarTags;
+    ReplacementPolicy replacement;
+
+    // Which cores hold each block; kept in step with every fill, eviction
+    // and invalidation so misses only visit the caches that matter
+    SharerDirectory directory;
+
+    // Data checking: each write stamps its block with a new version number.
+    // Reads must find the stamp of the latest write in their line.
+    bool checkData;
+    uint32_t dataVersion;
+    long long dataMismatches;
+    std::unordered_map<Address, uint32_t> latestData;  // block -> last written version
+    std::unordered_map<Address, uint32_t> memoryData;  // block -> version held by memory
+
+    // Checkpointing. Checkpoints are only taken at cycle boundaries, before
+    // any core has acted in the new cycle, so the event queue can be rebuilt
+    // from the cores' ready cycles on restore.
+    std::string tracePrefix;
+    const TraceSet* traceSet;  // the records replayed, if not read from the trace files
+    std::string checkpointFile;
+    long long checkpointEvery;
+    long long nextCheckpoint;  // cycle at or after which the next periodic checkpoint is due
+    long long stopCycle;
+    bool stopped;        // run ended early at stopCycle or on a signal
+
+    // Sampled simulation (SMARTS): functional warming between detailed
+    // windows of sampleWarmup + sampleUnit references per core
+    int samplePeriod;
+    int sampleWarmup;
+    int sampleUnit;
+    bool sampleFastForward;
+    bool warming;        // functional warming: coherence state only, no bus timing
+    // The rough bus model that orders the cores during warming (warmCores)
+    long long warmClock;               // clock of the core being warmed
+    long long warmBusFree;             // atomic bus, or the split bus's address bus
+    std::vector<long long> warmSlots;  // split bus: when each memory request slot frees
+    long long completedReferences;
+    long long skippedReferences; // fast-forwarded past without simulating them
+    std::vector<SampleUnit> samples;
+
+    // Parallel engine. Strict mode only runs ahead through blocks that no
+    // other core's trace touches (sharedBlocks holds the rest, and maybe a
+    // few private ones), so results
+    // match the sequential engines exactly; relaxed mode runs ahead through
+    // any hit, at most quantum cycles past the earliest pending event.
+    bool parallel;
+    bool relaxed;
+    int quantum;
+    SharedBlockFilter sharedBlocks;
+
+    PhaseProfiler profiler; // --profile
+    HotBlockProfiler hotBlocks; // --hot-blocks, enabled once the cores are known
+    int hotBlockCount;
+
+    // Interval statistics: a row per core for every intervalCycles cycles,
+    // or each time intervalReferences references have gone by (taken at the
+    // next cycle boundary)
+    IntervalWriter intervals;
+    long long intervalCycles;
+    long long intervalReferences;
+    long long nextIntervalCycle;      // LLONG_MAX when not by cycles
+    long long nextIntervalReference;  // LLONG_MAX when not by references
+    long long intervalIndex;
+    long long intervalStartCycle;
+    std::vector<IntervalRow> intervalBase; // each core's totals at intervalStartCycle
+    std::string summaryFile;
+
+    std::chrono::steady_clock::time_point constructStart;
+    double constructSeconds;
+    double runSeconds;
+
+    BasicCacheSimulator(int s, int E, int b, const std::string& outFileName, bool debug,
+                        const SimulatorOptions& options);
+    void addCore(std::unique_ptr<TraceReader> trace);
+
+    void releaseBusIfDone();
+    long long occupyBus(int coreId, BusTransaction transaction, int cycles, long long after = 0);
+    long long scheduleSplit(int coreId, BusTransaction transaction, int cycles, long long after);
+    long long scheduleWarm(BusTransaction transaction, int cycles, long long after);
+    void bookBusWindow(int coreId, long long start, long long cycles);
+    long long reserveDataBus(long long ready, int cycles);
+    bool busAvailable() const;
+    long long busWait() const;
+    void completeReference(int coreId, long long nextReady);
+    // Whether a reference's address fits in Address; addressTooWide throws
+    static bool fits(const TraceRecord& record) {
+        return sizeof(Address) == sizeof(uint64_t) || (record.word >> 33) == 0;
+    }
+    void addressTooWide(int coreId) const;
+    Address blockOf(Address address) const { return address >> blockBits; }
+    int invalidateOthers(int coreId, Address address);
+    void invalidateSharers(int coreId, Address address);
+    Line& fillLine(int coreId, Address address, CacheLineState state);
+    void loadLineData(int coreId, Line& line, Address address);
+    void copyLineData(int toCore, Line& to, int fromCore, Line& from);
+    void writeBackLineData(int coreId, Line& line, Address address);
+    void checkLineData(int coreId, Line& line, Address address, bool isWrite);
+    long long issueReadMiss(int coreId, Address address);
+    long long issueWriteMiss(int coreId, Address address);
+    void stepCore(int coreId, bool skipAhead);
+    void runCycleLoop();
+    void runEventLoop(long long maxReferences = LLONG_MAX);
+    void runSampled();
+    void runParallelLoop();
+    void findSharedBlocks(CoreWorkers& workers);
+    long long runAhead(int coreId, long long horizon);
+    void warmCores(int between);
+    long long warmReference(int coreId, Line* line);
+    void skipReferences(int coreId, long long count);
+    void quiesce();
+    bool atCycleBoundary();
+    void rebuildDirectory();
+    void resetStatistics();
+    IntervalRow intervalTotals(int coreId, long long end) const;
+    void startIntervals();
+    void emitIntervalsUntil(long long cycle);
+    void emitInterval(long long end);
+    void writeSummary(const std::string& path);
+
+public:
+    BasicCacheSimulator(const std::string& traceFilePrefix, int s, int E, int b,
+                        const std::string& outFileName, bool debug, const SimulatorOptions& options);
+    BasicCacheSimulator(const TraceSet& traces, int s, int E, int b,
+                        const std::string& outFileName, bool debug, const SimulatorOptions& options);
+    ~BasicCacheSimulator();
+    void runSimulation();
+    void simulate();
+
+    int getNumCores() const { return numCores; }
+    CoreStatistics getCoreStatistics(int coreId) const;
+    long long getTotalBusTransactions() const { return totalBusTransactions; }
+    long long getTotalBusTraffic() const { return totalBusTraffic; }
+    long long getTotalInvalidations() const { return totalInvalidations; }
+    long long getGlobalCycle() const { return globalCycle; }
+    double getRunSeconds() const { return runSeconds; }
+    int getAddressBits() const { return 8 * (int)sizeof(Address); }
+    void printStatistics();
+    void printPerformance();
+
+    void saveCheckpoint(const std::string& path);
+    void restoreCheckpoint(const std::string& path, bool resetStats);
+    bool isStopped() const { return stopped; }
+    void printBusStatistics(std::ostream& out);
+    void printSampleEstimates(std::ostream& out);
+    void printProfile(std::ostream& out);
+    const std::vector<SampleUnit>& getSamples() const { return samples; }
+    const BusTransactionStats& getBusStatistics(BusTransaction transaction) const { return busStats[transaction]; }
+};
+
+#endif // BASIC_CACHE_SIMULATOR_H
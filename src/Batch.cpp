@@ -0,0 +1,192 @@
+#include "Batch.h"
+#include "RunSummary.h"
+#include "TraceReader.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+
+static bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static long long fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long long)st.st_size : 0;
+}
+
+static void globInto(const std::string& pattern, std::vector<std::string>& paths) {
+    glob_t matches;
+    if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+        for (size_t i = 0; i < matches.gl_pathc; i++) paths.push_back(matches.gl_pathv[i]);
+    }
+    globfree(&matches);
+}
+
+std::vector<std::string> findTracePrefixes(const std::string& pattern) {
+    std::vector<std::string> paths;
+    if (isDirectory(pattern)) {
+        DIR* dir = opendir(pattern.c_str());
+        if (!dir) throw std::runtime_error("cannot read directory: " + pattern);
+        std::string base = pattern;
+        if (!base.empty() && base[base.size() - 1] != '/') base += '/';
+        for (struct dirent* entry = readdir(dir); entry; entry = readdir(dir)) {
+            paths.push_back(base + entry->d_name);
+        }
+        closedir(dir);
+    } else {
+        globInto(pattern, paths);
+        globInto(pattern + "_proc*", paths);
+    }
+
+    std::set<std::string> prefixes;
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::string prefix = tracePrefixOf(paths[i]);
+        if (!prefix.empty()) prefixes.insert(prefix);
+    }
+    return std::vector<std::string>(prefixes.begin(), prefixes.end());
+}
+
+namespace {
+
+struct BatchJob {
+    std::string prefix;
+    long long bytes; // on-disk size of its traces, used to order the runs
+};
+
+// Each worker owns a deque and takes from its front; an idle worker steals
+// from the back of someone else's. Jobs are dealt out round-robin in
+// decreasing size, so every worker starts on one of the biggest runs and
+// stealing evens out the tail.
+class WorkStealingQueues {
+private:
+    std::vector<std::deque<BatchJob> > queues;
+    std::vector<std::unique_ptr<std::mutex> > locks;
+
+public:
+    WorkStealingQueues(const std::vector<BatchJob>& jobs, int workers)
+        : queues(workers) {
+        for (int w = 0; w < workers; w++) locks.push_back(std::unique_ptr<std::mutex>(new std::mutex));
+        for (size_t i = 0; i < jobs.size(); i++) queues[i % workers].push_back(jobs[i]);
+    }
+
+    bool take(int worker, BatchJob& job) {
+        {
+            std::lock_guard<std::mutex> guard(*locks[worker]);
+            if (!queues[worker].empty()) {
+                job = queues[worker].front();
+                queues[worker].pop_front();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); k++) {
+            size_t victim = (worker + k) % queues.size();
+            std::lock_guard<std::mutex> guard(*locks[victim]);
+            if (!queues[victim].empty()) {
+                job = queues[victim].back();
+                queues[victim].pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Counting semaphore bounding how many decoded trace sets are alive
+class LoadLimiter {
+private:
+    std::mutex lock;
+    std::condition_variable freed;
+    int available;
+
+public:
+    explicit LoadLimiter(int slots) : available(slots) {}
+
+    void acquire() {
+        std::unique_lock<std::mutex> guard(lock);
+        freed.wait(guard, [this]() { return available > 0; });
+        available--;
+    }
+    void release() {
+        std::lock_guard<std::mutex> guard(lock);
+        available++;
+        freed.notify_one();
+    }
+};
+
+} // namespace
+
+void runBatch(const std::string& pattern, int s, int E, int b,
+              const std::string& outFileName, int jobs, int maxLoaded,
+              const SimulatorOptions& options) {
+    std::vector<std::string> prefixes = findTracePrefixes(pattern);
+    if (prefixes.empty()) throw std::runtime_error("no traces match " + pattern);
+
+    std::vector<BatchJob> batch;
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        BatchJob job = { prefixes[i], 0 };
+        int numCores = options.numCores > 0 ? options.numCores : findCoreCount(prefixes[i]);
+        for (int core = 0; core < numCores; core++) job.bytes += fileSize(resolveTracePath(prefixes[i], core));
+        batch.push_back(job);
+    }
+    std::stable_sort(batch.begin(), batch.end(),
+                     [](const BatchJob& x, const BatchJob& y) { return x.bytes > y.bytes; });
+
+    int workers = std::max(1, std::min(jobs, (int)batch.size()));
+    std::cerr << "Batch of " << batch.size() << " trace sets on " << workers << " threads, at most "
+              << maxLoaded << " decoded at once" << std::endl;
+
+    std::ofstream outFile;
+    if (!outFileName.empty()) {
+        outFile.open(outFileName);
+        if (!outFile.is_open()) throw std::runtime_error("cannot create " + outFileName);
+    }
+    std::ostream &out = (outFile.is_open() ? outFile : std::cout);
+    bool json = isJsonPath(outFileName);
+    if (!json) out << "prefix," << RunSummary::csvHeader() << std::endl;
+
+    WorkStealingQueues queues(batch, workers);
+    LoadLimiter limiter(std::max(1, maxLoaded));
+    std::mutex outLock;
+    SimulatorOptions runOptions = options;
+    runOptions.reportPerformance = false;
+
+    auto worker = [&](int id) {
+        BatchJob job;
+        while (queues.take(id, job)) {
+            std::string line;
+            limiter.acquire();
+            try {
+                TraceSet traces(job.prefix, options.numCores);
+                CacheSimulator sim(traces, s, E, b, "", false, runOptions);
+                sim.simulate();
+                RunSummary summary(sim, s, E, b);
+                line = json ? "{\"prefix\": " + jsonString(job.prefix) + ", " + summary.jsonFields() + "}"
+                            : job.prefix + "," + summary.csvRow();
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> guard(outLock);
+                std::cerr << "Error: " << job.prefix << ": " << e.what() << std::endl;
+            }
+            limiter.release();
+
+            if (!line.empty()) {
+                std::lock_guard<std::mutex> guard(outLock);
+                out << line << std::endl; // flushed so results stream out as runs finish
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 1; w < workers; w++) threads.push_back(std::thread(worker, w));
+    worker(0);
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+}
@@ -0,0 +1,22 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "CacheSimulator.h"
+#include <string>
+#include <vector>
+
+// Trace prefixes ("dir/appN") named by a directory or a glob. A directory
+// yields every prefix with _procK traces in it; a glob may match either
+// prefixes or trace files.
+std::vector<std::string> findTracePrefixes(const std::string& pattern);
+
+// Simulate every prefix matched by pattern with one fixed configuration.
+// Runs are spread over jobs work-stealing workers, biggest traces first, and
+// each result is appended to outFileName (stdout if empty) as soon as its
+// run finishes: JSON lines if the name ends in .json/.jsonl, CSV otherwise.
+// At most maxLoaded trace sets are held decoded in memory at any time.
+void runBatch(const std::string& pattern, int s, int E, int b,
+              const std::string& outFileName, int jobs, int maxLoaded,
+              const SimulatorOptions& options);
+
+#endif // BATCH_H
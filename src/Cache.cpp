@@ -0,0 +1,337 @@
+#include "Cache.h"
+#include "Checkpoint.h"
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CACHE_SIMD_TAGS 1
+#include <immintrin.h>
+#else
+#define CACHE_SIMD_TAGS 0
+#endif
+
+template <typename Address>
+const Address Cache<Address>::INVALID_TAG;
+
+static int replacementSetWords(ReplacementPolicy replacement) {
+    switch (replacement) {
+    case REPLACE_LRU: return LruPolicy::SET_WORDS;
+    case REPLACE_PLRU: return PlruPolicy::SET_WORDS;
+    case REPLACE_SRRIP: return RripPolicy<false>::SET_WORDS;
+    case REPLACE_BRRIP: return RripPolicy<true>::SET_WORDS;
+    case REPLACE_NRU: return NruPolicy::SET_WORDS;
+    default: return RandomPolicy::SET_WORDS;
+    }
+}
+
+template <typename Address>
+Cache<Address>::Cache(int coreId, int s, int E, int b, bool withData, bool genericKernels, bool scalarTags,
+                      ReplacementPolicy replacement)
+    : coreId(coreId), numSets(1 << s), associativity(E), blockSize(1 << b),
+      blockOffsetBits(b), setIndexBits(s), replacement(replacement),
+      setWords(replacementSetWords(replacement)), randomState(2463534242u + coreId),
+      kernels(selectKernels(E, b, replacement, genericKernels, scalarTags)) {
+    std::string problem = replacementCheck(replacement, E);
+    if (!problem.empty()) throw std::runtime_error(problem);
+    lines.resize((size_t)numSets * associativity);
+    tags.assign(lines.size(), INVALID_TAG);
+    replacementWords.resize((size_t)numSets * setWords);
+    if (replacement == REPLACE_LRU) links.resize(2 * lines.size());
+    kernels.reset(*this);
+    if (withData) data.resize(lines.size() * blockSize, 0);
+}
+
+//
+// Tag compares: the way among tags[0 .. ways-1] holding tag, or -1. At most
+// one way can match, since a block is resident at most once and invalid ways
+// hold INVALID_TAG.
+//
+template <typename Address>
+static inline int matchScalar(const Address* tags, int ways, Address tag) {
+    for (int way = 0; way < ways; way++) {
+        if (tags[way] == tag) return way;
+    }
+    return -1;
+}
+
+#if CACHE_SIMD_TAGS
+__attribute__((target("sse4.1")))
+static inline int matchSse(const uint32_t* tags, int ways, uint32_t tag) {
+    __m128i wanted = _mm_set1_epi32((int)tag);
+    int way = 0;
+    for (; way + 4 <= ways; way += 4) {
+        __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(tags + way)), wanted);
+        int hits = _mm_movemask_ps(_mm_castsi128_ps(equal));
+        if (hits) return way + __builtin_ctz(hits);
+    }
+    int rest = matchScalar(tags + way, ways - way, tag);
+    return rest < 0 ? -1 : way + rest;
+}
+
+__attribute__((target("sse4.1")))
+static inline int matchSse(const uint64_t* tags, int ways, uint64_t tag) {
+    __m128i wanted = _mm_set1_epi64x((long long)tag);
+    int way = 0;
+    for (; way + 2 <= ways; way += 2) {
+        __m128i equal = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(tags + way)), wanted);
+        int hits = _mm_movemask_pd(_mm_castsi128_pd(equal));
+        if (hits) return way + __builtin_ctz(hits);
+    }
+    int rest = matchScalar(tags + way, ways - way, tag);
+    return rest < 0 ? -1 : way + rest;
+}
+
+// Whole 32-byte chunks, then whatever is left with SSE
+__attribute__((target("avx2")))
+static inline int matchAvx2(const uint32_t* tags, int ways, uint32_t tag) {
+    __m256i wanted = _mm256_set1_epi32((int)tag);
+    int way = 0;
+    for (; way + 8 <= ways; way += 8) {
+        __m256i equal = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(tags + way)), wanted);
+        int hits = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+        if (hits) return way + __builtin_ctz(hits);
+    }
+    int rest = matchSse(tags + way, ways - way, tag);
+    return rest < 0 ? -1 : way + rest;
+}
+
+__attribute__((target("avx2")))
+static inline int matchAvx2(const uint64_t* tags, int ways, uint64_t tag) {
+    __m256i wanted = _mm256_set1_epi64x((long long)tag);
+    int way = 0;
+    for (; way + 4 <= ways; way += 4) {
+        __m256i equal = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(tags + way)), wanted);
+        int hits = _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+        if (hits) return way + __builtin_ctz(hits);
+    }
+    int rest = matchSse(tags + way, ways - way, tag);
+    return rest < 0 ? -1 : way + rest;
+}
+#endif
+
+enum TagCompare { COMPARE_SCALAR, COMPARE_SSE, COMPARE_AVX2, NUM_TAG_COMPARES };
+
+static const char* const TAG_COMPARE_NAMES[NUM_TAG_COMPARES] = { "Scalar", "SSE4.1", "AVX2" };
+
+//
+// Lookup kernels. Ways and BlockBits are the geometry when it is known at
+// compile time, 0 when it has to be read from the cache. findLine comes in
+// one version per tag compare; each carries its target attribute so the
+// compare inlines into it. The rest come in one version per replacement
+// policy.
+//
+template <typename Address>
+struct CacheKernels {
+    typedef Cache<Address> Owner;
+    typedef typename Owner::Line Line;
+    typedef typename Owner::Kernels Kernels;
+    typedef Line* (*FindLine)(Owner&, Address);
+
+    struct PolicyKernels {
+        void (*touch)(Owner& cache, Line& line);
+        Line& (*victimFor)(Owner& cache, Address address);
+        void (*insert)(Owner& cache, Line& line);
+        void (*invalidate)(Owner& cache, Line& line);
+        void (*reset)(Owner& cache);
+    };
+
+    // Kernels of one geometry, by TagCompare and ReplacementPolicy
+    struct Variants {
+        FindLine find[NUM_TAG_COMPARES];
+        PolicyKernels policy[NUM_REPLACEMENT_POLICIES];
+    };
+
+    // Set index and tag of address
+    template <int BlockBits>
+    static unsigned int locate(Owner& cache, Address address, Address& tag) {
+        const int offsetBits = BlockBits ? BlockBits : cache.blockOffsetBits;
+        tag = address >> (offsetBits + cache.setIndexBits);
+        return (unsigned int)(address >> offsetBits) & (cache.numSets - 1);
+    }
+
+    static Line* lineAt(Owner& cache, size_t first, int way) {
+        return way < 0 ? nullptr : &cache.lines[first + way];
+    }
+
+    template <int Ways, int BlockBits>
+    static Line* findLineScalar(Owner& cache, Address address) {
+        const int ways = Ways ? Ways : cache.associativity;
+        Address tag;
+        size_t first = (size_t)locate<BlockBits>(cache, address, tag) * ways;
+        return lineAt(cache, first, matchScalar(&cache.tags[first], ways, tag));
+    }
+
+#if CACHE_SIMD_TAGS
+    template <int Ways, int BlockBits>
+    __attribute__((target("sse4.1")))
+    static Line* findLineSse(Owner& cache, Address address) {
+        const int ways = Ways ? Ways : cache.associativity;
+        Address tag;
+        size_t first = (size_t)locate<BlockBits>(cache, address, tag) * ways;
+        return lineAt(cache, first, matchSse(&cache.tags[first], ways, tag));
+    }
+
+    template <int Ways, int BlockBits>
+    __attribute__((target("avx2")))
+    static Line* findLineAvx2(Owner& cache, Address address) {
+        const int ways = Ways ? Ways : cache.associativity;
+        Address tag;
+        size_t first = (size_t)locate<BlockBits>(cache, address, tag) * ways;
+        return lineAt(cache, first, matchAvx2(&cache.tags[first], ways, tag));
+    }
+#endif
+
+    // Replacement state of a set, with ways a constant where Ways is
+    template <typename Policy, int Ways>
+    static ReplacementSet setAt(Owner& cache, size_t setIndex) {
+        const int ways = Ways ? Ways : cache.associativity;
+        ReplacementSet set = { &cache.replacementWords[setIndex * Policy::SET_WORDS],
+                               cache.links.empty() ? nullptr : &cache.links[2 * setIndex * ways],
+                               &cache.randomState, ways };
+        return set;
+    }
+
+    template <typename Policy, int Ways>
+    static void touch(Owner& cache, Line& line) {
+        const int ways = Ways ? Ways : cache.associativity;
+        size_t index = cache.indexOf(line);
+        ReplacementSet set = setAt<Policy, Ways>(cache, index / ways);
+        Policy::touch(set, (int)(index % ways));
+    }
+
+    template <typename Policy, int Ways, int BlockBits>
+    static Line& victimFor(Owner& cache, Address address) {
+        const int ways = Ways ? Ways : cache.associativity;
+        Address tag;
+        unsigned int setIndex = locate<BlockBits>(cache, address, tag);
+        ReplacementSet set = setAt<Policy, Ways>(cache, setIndex);
+        return cache.lines[(size_t)setIndex * ways + Policy::victim(set)];
+    }
+
+    template <typename Policy, int Ways>
+    static void insert(Owner& cache, Line& line) {
+        const int ways = Ways ? Ways : cache.associativity;
+        size_t index = cache.indexOf(line);
+        ReplacementSet set = setAt<Policy, Ways>(cache, index / ways);
+        Policy::insert(set, (int)(index % ways));
+    }
+
+    template <typename Policy, int Ways>
+    static void invalidate(Owner& cache, Line& line) {
+        const int ways = Ways ? Ways : cache.associativity;
+        size_t index = cache.indexOf(line);
+        ReplacementSet set = setAt<Policy, Ways>(cache, index / ways);
+        Policy::invalidate(set, (int)(index % ways));
+    }
+
+    template <typename Policy>
+    static void reset(Owner& cache) {
+        for (int setIndex = 0; setIndex < cache.numSets; setIndex++) {
+            ReplacementSet set = setAt<Policy, 0>(cache, setIndex);
+            Policy::init(set);
+        }
+    }
+
+    template <typename Policy, int Ways, int BlockBits>
+    static PolicyKernels policyKernels() {
+        PolicyKernels k = { &touch<Policy, Ways>, &victimFor<Policy, Ways, BlockBits>, &insert<Policy, Ways>,
+                            &invalidate<Policy, Ways>, &reset<Policy> };
+        return k;
+    }
+
+    template <int Ways, int BlockBits>
+    static Variants make() {
+        Variants v = {
+            { &findLineScalar<Ways, BlockBits>,
+#if CACHE_SIMD_TAGS
+              &findLineSse<Ways, BlockBits>, &findLineAvx2<Ways, BlockBits>
+#else
+              &findLineScalar<Ways, BlockBits>, &findLineScalar<Ways, BlockBits>
+#endif
+            },
+            // In ReplacementPolicy order
+            { policyKernels<LruPolicy, Ways, BlockBits>(), policyKernels<PlruPolicy, Ways, BlockBits>(),
+              policyKernels<RripPolicy<false>, Ways, BlockBits>(), policyKernels<RripPolicy<true>, Ways, BlockBits>(),
+              policyKernels<NruPolicy, Ways, BlockBits>(), policyKernels<RandomPolicy, Ways, BlockBits>() }
+        };
+        return v;
+    }
+};
+
+// The widest compare worth using on E ways of tags: a set too small to fill
+// one vector stays scalar
+static TagCompare chooseTagCompare(int E, size_t tagBytes, bool scalarTags) {
+    size_t setBytes = (size_t)E * tagBytes;
+    if (scalarTags || setBytes < 16) return COMPARE_SCALAR;
+#if CACHE_SIMD_TAGS
+    __builtin_cpu_init();
+    if (setBytes >= 32 && __builtin_cpu_supports("avx2")) return COMPARE_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return COMPARE_SSE;
+#endif
+    return COMPARE_SCALAR;
+}
+
+// The geometries that get kernels of their own: E in {1, 2, 4, 8, 16} by
+// b in {5, 6, 7}, i.e. 32 to 128-byte blocks
+static const int KERNEL_BLOCK_BITS_MIN = 5;
+static const int KERNEL_BLOCK_BITS_MAX = 7;
+
+template <typename Address>
+typename Cache<Address>::Kernels Cache<Address>::selectKernels(int E, int b, ReplacementPolicy replacement,
+                                                               bool generic, bool scalarTags) {
+    typedef CacheKernels<Address> K;
+    static const typename K::Variants table[5][3] = {
+        { K::template make<1, 5>(), K::template make<1, 6>(), K::template make<1, 7>() },
+        { K::template make<2, 5>(), K::template make<2, 6>(), K::template make<2, 7>() },
+        { K::template make<4, 5>(), K::template make<4, 6>(), K::template make<4, 7>() },
+        { K::template make<8, 5>(), K::template make<8, 6>(), K::template make<8, 7>() },
+        { K::template make<16, 5>(), K::template make<16, 6>(), K::template make<16, 7>() },
+    };
+    static const typename K::Variants runtime = K::template make<0, 0>();
+
+    TagCompare compare = chooseTagCompare(E, sizeof(Address), scalarTags);
+    int row = -1;
+    for (int i = 0; i < 5; i++) {
+        if (E == 1 << i) row = i;
+    }
+    bool specialised = !generic && row >= 0 && b >= KERNEL_BLOCK_BITS_MIN && b <= KERNEL_BLOCK_BITS_MAX;
+    const typename K::Variants& v = specialised ? table[row][b - KERNEL_BLOCK_BITS_MIN] : runtime;
+    const typename K::PolicyKernels& p = v.policy[replacement];
+    Kernels k = { v.find[compare], p.touch, p.victimFor, p.insert, p.invalidate, p.reset,
+                  specialised, TAG_COMPARE_NAMES[compare] };
+    return k;
+}
+
+template <typename Address>
+void Cache<Address>::fillLine(Line& line, Address address, CacheLineState state) {
+    tags[indexOf(line)] = getTag(address);
+    line.shared = 0;
+    setState(line, state);
+    kernels.insert(*this, line);
+}
+
+template <typename Address>
+void Cache<Address>::saveState(CheckpointWriter& out) const {
+    out.putBytes(lines.data(), lines.size() * sizeof(Line));
+    out.putBytes(tags.data(), tags.size() * sizeof(Address));
+    out.putBytes(replacementWords.data(), replacementWords.size() * sizeof(uint64_t));
+    out.putBytes(links.data(), links.size() * sizeof(uint16_t));
+    out.put(randomState);
+    if (!data.empty()) out.putBytes(data.data(), data.size());
+}
+
+template <typename Address>
+void Cache<Address>::loadState(CheckpointReader& in, bool hasData) {
+    in.getBytes(lines.data(), lines.size() * sizeof(Line));
+    in.getBytes(tags.data(), tags.size() * sizeof(Address));
+    in.getBytes(replacementWords.data(), replacementWords.size() * sizeof(uint64_t));
+    in.getBytes(links.data(), links.size() * sizeof(uint16_t));
+    in.get(randomState);
+    size_t dataBytes = lines.size() * (size_t)blockSize;
+    if (hasData && !data.empty()) in.getBytes(data.data(), dataBytes);
+    else if (hasData) in.skip(dataBytes);
+}
+
+// The simulator picks the width from the traces; 32-bit traces keep the
+// 4-byte tags
+template class Cache<uint32_t>;
+template class Cache<uint64_t>;
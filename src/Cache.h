@@ -3,9 +3,49 @@
 
 #include "utils.h"
 #include "CacheLine.h"
+#include "Replacement.h"
 #include <vector>
 
+class CheckpointWriter;
+class CheckpointReader;
+template <typename Address> struct CacheKernels;
+
+// Tag store of one core's L1. All lines live in a single flat array, set by
+// set: the E ways of set i are lines[i*E .. i*E+E-1]. The tags are kept out
+// of the lines, in a parallel array with the same layout, so the E tags of a
+// set are contiguous and a lookup compares them several at a time with SSE
+// or AVX2 where the CPU has it. Address is uint32_t or uint64_t (see
+// Cache.cpp); tags are stored at the same width.
+//
+// The per-reference path (lookup, replacement update, victim choice) goes
+// through a table of kernels compiled for fixed associativity, block size and
+// replacement policy, so the way loops unroll and the address arithmetic
+// folds to constants. Geometries without a specialised kernel, or any with
+// genericKernels, use the instantiation that reads them at run time.
+template <typename Address>
 class Cache {
+    template <typename> friend struct CacheKernels;
+
+public:
+    typedef CacheLine Line;
+
+    // Tag held by invalid ways. No resident block has it: block offsets are
+    // at least one bit and trace addresses below TRACE_ADDRESS_LIMIT (63
+    // bits, enforced by the trace readers), so a real tag never has its top
+    // bit set.
+    static const Address INVALID_TAG = ~(Address)0;
+
+    struct Kernels {
+        Line* (*findLine)(Cache& cache, Address address);
+        void (*touch)(Cache& cache, Line& line);
+        Line& (*victimFor)(Cache& cache, Address address);
+        void (*insert)(Cache& cache, Line& line);      // line was just filled
+        void (*invalidate)(Cache& cache, Line& line);  // line was just invalidated
+        void (*reset)(Cache& cache);                   // every set to its cold state
+        bool specialised;
+        const char* tagCompare; // instruction set findLine compares tags with
+    };
+
 private:
     int coreId;
     int numSets;
@@ -13,93 +53,86 @@ private:
     int blockSize;
     int blockOffsetBits;
     int setIndexBits;
-    int tagBits;
-    std::vector<CacheSet> sets;
-    
-    // Statistics
-    int readCount;
-    int writeCount;
-    int missCount;
-    int hitCount;
-    int evictionCount;
-    int writebackCount;
-    int totalCycles;
-    int idleCycles;
-    int busInvalidations;
-    int busTraffic; // in bytes
-    
-    // Helper functions
-    unsigned int getSetIndex(unsigned int address) const;
-    unsigned int getTag(unsigned int address) const;
-    unsigned int getBlockOffset(unsigned int address) const;
-    int findLineInSet(unsigned int setIndex, unsigned int tag) const;
-    int getLRULine(unsigned int setIndex);
-    void updateLRU(unsigned int setIndex, int lineIndex);
-    void evictLine(unsigned int setIndex, int lineIndex, int& cycle);
+    std::vector<Line> lines;
+    std::vector<Address> tags;       // tag of each line, INVALID_TAG when it is invalid
+    std::vector<unsigned char> data; // blockSize bytes per line, only when checking data
+
+    // Replacement state: setWords words per set, LRU links, random state
+    ReplacementPolicy replacement;
+    int setWords;
+    std::vector<uint64_t> replacementWords;
+    std::vector<uint16_t> links;
+    uint32_t randomState;
+    Kernels kernels;
+
+    Line* setBegin(unsigned int setIndex) { return &lines[(size_t)setIndex * associativity]; }
+    size_t indexOf(const Line& line) const { return &line - &lines[0]; }
+
+    static Kernels selectKernels(int E, int b, ReplacementPolicy replacement, bool generic, bool scalarTags);
 
 public:
-    Cache(int coreId, int s, int E, int b);
-    
-    // Core cache operations
-    bool processRequest(MemoryOperation op, unsigned int address, int& cycle, 
-                      std::vector<Cache*>& otherCaches);
-    
-    // Bus snooping operations
-    bool handleBusRequest(BusTransaction busOp, unsigned int address, 
-                        Cache* requestingCache, int& cycle, int& bytesTransferred);
-    bool checkDataInOtherCaches(unsigned int address, std::vector<Cache*>& otherCaches, 
-                               int& bytesTransferred);
-    
-    // Statistics functions
-    int getReadCount() const { return readCount; }
-    int getWriteCount() const { return writeCount; }
-    int getMissCount() const { return missCount; }
-    int getHitCount() const { return hitCount; }
-    int getEvictionCount() const { return evictionCount; }
-    int getWritebackCount() const { return writebackCount; }
-    int getTotalCycles() const { return totalCycles; }
-    int getIdleCycles() const { return idleCycles; }
-    int getBusInvalidations() const { return busInvalidations; }
-    int getBusTraffic() const { return busTraffic; }
-    double getMissRate() const { 
-        return (readCount + writeCount > 0) ? 
-            (double)missCount / (readCount + writeCount) : 0.0; 
+    // scalarTags keeps the tag compare off SIMD even where the CPU has it.
+    // Throws if the replacement policy does not support E ways.
+    Cache(int coreId, int s, int E, int b, bool withData = false, bool genericKernels = false,
+          bool scalarTags = false, ReplacementPolicy replacement = REPLACE_LRU);
+
+    // Address decomposition
+    unsigned int getSetIndex(Address address) const {
+        return (unsigned int)(address >> blockOffsetBits) & (numSets - 1);
+    }
+    Address getTag(Address address) const {
+        return address >> (blockOffsetBits + setIndexBits);
     }
-    
-    // Debug function
-    void printState();
-
-    // Add this method declaration to the public section:
-    void printDebugInfo(MemoryOperation op, unsigned int address, bool isHit, CacheLineState oldState = INVALID, CacheLineState newState = INVALID);    
-
-    // Add to public methods
-    void addIdleTime(int cycles) { idleCycles += cycles; }
-
-    // New method to handle cache-to-cache transfer receipt
-    void receiveCacheToCache(unsigned int address, CacheLineState newState, int transferCycles) {
-        unsigned int setIndex = getSetIndex(address);
-        unsigned int tag = getTag(address);
-        int lineIndex = findLineInSet(setIndex, tag);
-        
-        // Add transfer cycles to idle time
-        idleCycles += transferCycles;
-        
-        // After transfer is complete, update the cache (1 additional cycle)
-        totalCycles += 1;
+    unsigned int getBlockOffset(Address address) const {
+        return (unsigned int)address & (blockSize - 1);
     }
 
-    // Add to public section:
-    CacheLineState getLineState(unsigned int setIndex, int lineIndex) const {
-        if (lineIndex != -1 && setIndex < sets.size()) {
-            return sets[setIndex].lines[lineIndex].state;
+    // Valid line holding address, or nullptr
+    Line* findLine(Address address) { return kernels.findLine(*this, address); }
+    // Record a hit on line with the replacement policy
+    void touch(Line& line) { kernels.touch(*this, line); }
+    Line& getLine(unsigned int setIndex, int lineIndex) { return setBegin(setIndex)[lineIndex]; }
+    void setState(Line& line, CacheLineState state) {
+        line.state = state;
+        line.valid = (state != INVALID);
+        line.dirty = (state == MODIFIED);
+        if (state == INVALID) {
+            tags[indexOf(line)] = INVALID_TAG;
+            kernels.invalidate(*this, line);
         }
-        return INVALID;
     }
+    // Whether this geometry has a kernel of its own
+    bool isSpecialised() const { return kernels.specialised; }
+    const char* getTagCompare() const { return kernels.tagCompare; }
+
+    // Block contents of a line, or nullptr when data is not tracked
+    unsigned char* lineData(const Line& line) {
+        return data.empty() ? nullptr : &data[indexOf(line) * (size_t)blockSize];
+    }
+    size_t footprintBytes() const {
+        return lines.size() * sizeof(Line) + tags.size() * sizeof(Address) +
+               replacementWords.size() * sizeof(uint64_t) + links.size() * sizeof(uint16_t) + data.size();
+    }
+
+    // Way that a fill of address will overwrite: an invalid way if any, else
+    // the one the replacement policy picks. The caller evicts whatever it holds before calling fillLine.
+    Line& victimFor(Address address) { return kernels.victimFor(*this, address); }
+    // Rebuild the block address of a resident line of setIndex
+    Address blockAddress(unsigned int setIndex, const Line& line) const {
+        return (tags[indexOf(line)] << (blockOffsetBits + setIndexBits)) | ((Address)setIndex << blockOffsetBits);
+    }
+    void fillLine(Line& line, Address address, CacheLineState state);
+
+    // Checkpointing: every line, every tag and the replacement state, then
+    // the block contents if they are tracked. hasData says whether the
+    // checkpoint holds contents.
+    void saveState(CheckpointWriter& out) const;
+    void loadState(CheckpointReader& in, bool hasData);
 
-    // Public accessors for debugging
-    unsigned int getSetIndexPublic(unsigned int address) const { return getSetIndex(address); }
-    unsigned int getTagPublic(unsigned int address) const { return getTag(address); }
-    int findLineInSetPublic(unsigned int setIndex, unsigned int tag) const { return findLineInSet(setIndex, tag); }
+    int getCoreId() const { return coreId; }
+    int getNumSets() const { return numSets; }
+    int getAssociativity() const { return associativity; }
+    ReplacementPolicy getReplacement() const { return replacement; }
 };
 
 #endif // CACHE_H
@@ -2,32 +2,25 @@
 #define CACHE_LINE_H
 
 #include "utils.h"
-#include <vector>
+#include <stdint.h>
 
-// Structure to represent a cache line
+// Per-line coherence state. Timing simulation never looks at block contents,
+// so there is no data here; Cache keeps a separate payload array only when
+// data checking is enabled. Tags live apart from the lines too, in one
+// contiguous array per set (see Cache.h), so a lookup can compare a whole set
+// of tags at once, and the replacement policy keeps its own per-set state
+// (see Replacement.h).
 struct CacheLine {
-    bool valid;
-    bool dirty;
-    CacheLineState state;
-    unsigned int tag;
-    unsigned int lastUsed; // For LRU replacement
-    std::vector<unsigned char> data;
+    uint8_t valid : 1;
+    uint8_t dirty : 1;
+    uint8_t state : 2; // CacheLineState
+    uint8_t shared : 1; // parallel engine: more than one core's trace touches the block
 
-    CacheLine(int blockSize) : valid(false), dirty(false), 
-                              state(INVALID), tag(0), lastUsed(0) {
-        data.resize(blockSize, 0);
-    }
-};
+    CacheLine() : valid(0), dirty(0), state(INVALID), shared(0) {}
 
-// Structure to represent a cache set
-struct CacheSet {
-    std::vector<CacheLine> lines;
-    
-    CacheSet(int associativity, int blockSize) {
-        for (int i = 0; i < associativity; i++) {
-            lines.push_back(CacheLine(blockSize));
-        }
-    }
+    CacheLineState getState() const { return (CacheLineState)state; }
 };
 
+static_assert(sizeof(CacheLine) == 1, "CacheLine must stay one byte");
+
 #endif // CACHE_LINE_H
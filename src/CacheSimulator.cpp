@@ -1,5 +1,10 @@
 #include "CacheSimulator.h"
+#include "BasicCacheSimulator.h"
 #include "utils.h"
+#include "TraceReader.h"
+#include "Cache.h"
+#include "Checkpoint.h"
+#include "RunSummary.h"
 #include <utility>
 #include <memory>        
 #include <iostream>
@@ -7,794 +12,1347 @@
 #include <sstream>
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include <queue>
+#include <functional>
 #include <cmath>
 #include <algorithm>
 #include <iomanip>
 #include <cassert>
+#include <cstring>
+#include <chrono>
+#include <stdexcept>
+#include <climits>
+#include <csignal>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/resource.h>
 using namespace std;
 
-struct CoreState {
-    std::unique_ptr<std::ifstream> trace;
-    std::string currentLine;
-    bool finished;
-    int extime;    // execution time counter
-    int idletime;  // idle time counter
-    
-    // Simplified cache: maps an address to a MESI state
-    std::unordered_map<unsigned int, CacheLineState> cache;
-    
-    // Statistics
-    int totalInstructions;
-    int readCount;
-    int writeCount;
-    int missCount;
-    int hitCount;
-    int evictionCount;
-    int writebackCount;
-    int busInvalidations;
-    int dataTraffic; // in bytes
-};
+static const int MEMORY_LATENCY = 100; // cycles for a memory read or writeback
+
+const char* busTransactionName(BusTransaction transaction) {
+    switch (transaction) {
+        case ReadWithIntentToModify: return "ReadWithIntentToModify";
+        case WriteBackOnOtherReadMiss: return "WriteBackOnOtherReadMiss";
+        case WriteBackOnEviction: return "WriteBackOnEviction";
+        case WriteBackOnOtherWriteMiss: return "WriteBackOnOtherWriteMiss";
+        case ReadFromMem: return "ReadFromMem";
+        case ReadCacheToCache: return "ReadCacheToCache";
+        case BroadCastInvalidate: return "BroadCastInvalidate";
+        default: return "None";
+    }
+}
+
+static bool usesMemory(BusTransaction transaction) {
+    return transaction != ReadCacheToCache && transaction != BroadCastInvalidate;
+}
+
+static bool isWriteBack(BusTransaction transaction) {
+    return transaction == WriteBackOnEviction || transaction == WriteBackOnOtherReadMiss ||
+           transaction == WriteBackOnOtherWriteMiss;
+}
+
+// Signals that ask for a checkpoint: SIGUSR1 to take one and carry on,
+// SIGINT/SIGTERM to take one and stop
+static volatile sig_atomic_t checkpointSignal = 0;
+
+static void onCheckpointSignal(int signal) {
+    checkpointSignal = signal;
+}
 
-CacheSimulator::CacheSimulator(const std::string& traceFilePrefix, int s, int E, int b, 
-                              const std::string& outFileName, bool debug)
-    : outFileName(outFileName), debugMode(debug) {
+static void installCheckpointSignals() {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = onCheckpointSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Address>
+BasicCacheSimulator<Address>::BasicCacheSimulator(int s, int E, int b, const std::string& outFileName, bool debug,
+                              const SimulatorOptions& options)
+    : outFileName(outFileName), eventDriven(options.eventDriven),
+      reportPerformance(options.reportPerformance), genericKernels(options.genericKernels),
+      scalarTags(options.scalarTags), replacement(options.replacement),
+      checkData(options.checkData),
+      dataVersion(0), dataMismatches(0), constructStart(std::chrono::steady_clock::now()),
+      constructSeconds(0), runSeconds(0) {
     
     // Store configuration parameters
     setIndexBits = s;
     associativity = E;
     blockBits = b;
     numSets = 1 << s;
-    numCores = 4; // Quad-core simulation
+    numCores = 0; // grows as traces are attached
+    traceSet = nullptr;
     totalInvalidations = 0;
     totalBusTraffic = 0;
     totalBusTransactions = 0;
     busTransaction = BusTransaction::None;
     globalCycle = 0;
     busFree = true;
+    busNextFree = 0;
     busOwner = -1;
+    splitBus = options.splitBus;
+    addressBusFree = 0;
+    reportBus = options.reportBus || options.splitBus;
+    std::memset(busStats, 0, sizeof(busStats));
+    if (splitBus) {
+        if (options.memoryRequests <= 0) throw std::runtime_error("need at least one memory request slot");
+        memorySlotFree.assign(options.memoryRequests, 0);
+    }
+    checkpointFile = options.checkpointFile;
+    checkpointEvery = options.checkpointEvery;
+    nextCheckpoint = (checkpointEvery > 0 && !checkpointFile.empty()) ? checkpointEvery : LLONG_MAX;
+    stopCycle = options.stopAt > 0 ? options.stopAt : LLONG_MAX;
+    stopped = false;
+    if (!checkpointFile.empty()) installCheckpointSignals();
+    samplePeriod = options.samplePeriod;
+    sampleWarmup = options.sampleWarmup;
+    sampleUnit = options.sampleUnit;
+    if (samplePeriod > 0 && (sampleUnit <= 0 || sampleWarmup < 0 || sampleWarmup + sampleUnit > samplePeriod)) {
+        throw std::runtime_error("sampling needs 0 < unit and warmup + unit <= period");
+    }
+    if (options.samplePeriod > 0 && options.sampleFastForward && options.checkData) {
+        throw std::runtime_error("data checking cannot fast-forward past writes");
+    }
+    sampleFastForward = options.sampleFastForward;
+    parallel = options.parallel;
+    relaxed = options.relaxed;
+    quantum = options.quantum;
+    if (parallel && (checkData || debug || !options.eventFile.empty())) {
+        throw std::runtime_error("the parallel engine supports neither data checking nor event tracing");
+    }
+    if (options.profile) profiler.enable();
+    hotBlockCount = options.hotBlocks;
+    intervalCycles = options.intervalCycles;
+    intervalReferences = options.intervalReferences;
+    nextIntervalCycle = LLONG_MAX;
+    nextIntervalReference = LLONG_MAX;
+    intervalIndex = 0;
+    intervalStartCycle = 0;
+    if (!options.intervalFile.empty()) {
+        if (intervalCycles <= 0 && intervalReferences <= 0) {
+            throw std::runtime_error("interval statistics need an interval in cycles or references");
+        }
+        intervals.open(options.intervalFile);
+    }
+    summaryFile = options.summaryFile;
+    warming = false;
+    warmClock = warmBusFree = 0;
+    completedReferences = 0;
+    skippedReferences = 0;
     
     // Block size (in bytes) from b bits: blockSize = 2^b
     blockSize = 1 << b;
-    
-    debugPrint("Initializing simulator with " + std::to_string(numCores) + " cores");
-    debugPrint("Block size: " + std::to_string(blockSize) + " bytes");
-    
-    // Open trace files: one per core
-    for (int i = 0; i < numCores; i++) {
-        CoreState core;
-        std::string fileName = traceFilePrefix + "_proc" + std::to_string(i) + ".trace";
-        // C++11 has no make_unique; reset the unique_ptr instead
-        core.trace.reset(new std::ifstream(fileName));
-        if (!core.trace->is_open()) {
-            std::cerr << "Error opening trace file: " << fileName << std::endl;
+    if (checkData && blockSize < (int)sizeof(uint32_t)) {
+        throw std::runtime_error("data checking needs blocks of at least 4 bytes (-b 2)");
+    }
+
+    // -d prints every event as text; --events writes them in binary
+    if (debug) {
+        tracer.setLevel(TRACE_ALL);
+        tracer.printTo(std::cout);
+    }
+    if (!options.eventFile.empty()) {
+        tracer.setLevel(std::max(options.traceLevel, debug ? TRACE_ALL : TRACE_OFF));
+        tracer.openFile(options.eventFile, options.eventRing > 0 ? options.eventRing : 65536, options.eventRing > 0);
+    }
+}
+
+template <typename Address>
+BasicCacheSimulator<Address>::BasicCacheSimulator(const std::string& traceFilePrefix, int s, int E, int b, 
+                              const std::string& outFileName, bool debug,
+                              const SimulatorOptions& options)
+    : BasicCacheSimulator(s, E, b, outFileName, debug, options) {
+    tracePrefix = traceFilePrefix;
+    // Open trace files: one per core, as many cores as there are traces
+    int count = options.numCores > 0 ? options.numCores : findCoreCount(traceFilePrefix);
+    if (count <= 0) {
+        std::cerr << "Error opening trace file: " << resolveTracePath(traceFilePrefix, 0) << std::endl;
+        exit(1);
+    }
+    cores.reserve(count);
+    for (int i = 0; i < count; i++) {
+        std::unique_ptr<TraceReader> trace;
+        try {
+            trace = TraceReader::openCore(traceFilePrefix, i, options.readAhead);
+        } catch (const std::exception& e) {
+            std::cerr << "Error opening trace file: " << resolveTracePath(traceFilePrefix, i) << std::endl;
             exit(1);
         }
-        // Read the first line if possible
-        if (std::getline(*core.trace, core.currentLine)) {
-            debugPrint("Core " + std::to_string(i) + " first instruction: " + core.currentLine);
+        addCore(std::move(trace));
+    }
+    constructSeconds = secondsSince(constructStart);
+}
+
+template <typename Address>
+BasicCacheSimulator<Address>::BasicCacheSimulator(const TraceSet& traces, int s, int E, int b,
+                              const std::string& outFileName, bool debug,
+                              const SimulatorOptions& options)
+    : BasicCacheSimulator(s, E, b, outFileName, debug, options) {
+    tracePrefix = traces.getPrefix();
+    traceSet = &traces;
+    cores.reserve(traces.getNumCores());
+    for (int i = 0; i < traces.getNumCores(); i++) {
+        addCore(traces.openReader(i));
+    }
+    constructSeconds = secondsSince(constructStart);
+}
+
+// Attach the next core, reading its references from trace
+template <typename Address>
+void BasicCacheSimulator<Address>::addCore(std::unique_ptr<TraceReader> trace) {
+    int i = numCores++;
+    CoreState core(i, setIndexBits, associativity, blockBits, checkData, genericKernels, scalarTags, replacement);
+    core.trace = std::move(trace);
+
+    // Read the first reference if possible
+    core.hasCurrent = core.trace->next(core.current);
+    core.finished = !core.hasCurrent;
+    core.consumed = core.hasCurrent ? 1 : 0;
+    core.extime = 0;
+    core.idletime = 0;
+    core.readyAt = 0;
+    core.idleFrom = 0;
+    core.missPending = false;
+    
+    // Initialize statistics
+    core.totalInstructions = 0;
+    core.readCount = 0;
+    core.writeCount = 0;
+    core.missCount = 0;
+    core.hitCount = 0;
+    core.evictionCount = 0;
+    core.writebackCount = 0;
+    core.busCycles = 0;
+    core.busInvalidations = 0;
+    core.dataTraffic = 0;
+    
+    cores.emplace_back(std::move(core));  // Use emplace_back to avoid unnecessary copies
+    directory.setNumCores(numCores);
+    directory.reserve((size_t)numCores * numSets * associativity);
+}
+
+template <typename Address>
+BasicCacheSimulator<Address>::~BasicCacheSimulator() {
+    // Trace readers close/unmap their files when the cores are destroyed
+}
+
+//
+// Bus ownership. The atomic bus carries one transaction at a time; whoever is
+// granted it keeps it until busNextFree, after which it is free again. The
+// split bus only needs its address bus to be free to grant a new request.
+//
+template <typename Address>
+bool BasicCacheSimulator<Address>::busAvailable() const {
+    return splitBus ? addressBusFree <= globalCycle : busFree;
+}
+
+template <typename Address>
+long long BasicCacheSimulator<Address>::busWait() const {
+    return (splitBus ? addressBusFree : busNextFree) - globalCycle;
+}
+
+template <typename Address>
+void BasicCacheSimulator<Address>::releaseBusIfDone() {
+    if (!splitBus && !busFree && globalCycle >= busNextFree) {
+        TRACE_EVENT(tracer, TRACE_ALL, globalCycle, busOwner, TE_BUS_RELEASE, 0);
+        busFree = true;
+        busOwner = -1;
+        busTransaction = None;
+    }
+}
+
+// Put a transaction on the bus on behalf of coreId and return the cycle at
+// which it completes. cycles is its uncontended cost. On the atomic bus,
+// transactions issued for the same miss queue up behind each other, so a
+// writeback followed by a fill keeps the bus for the sum of both. On the split
+// bus each is scheduled on its own, starting no earlier than after.
+template <typename Address>
+long long BasicCacheSimulator<Address>::occupyBus(int coreId, BusTransaction transaction, int cycles, long long after) {
+    if (warming) return scheduleWarm(transaction, cycles, after);
+    totalBusTransactions++;
+    if (splitBus) {
+        PROFILE_ENTER(profiler, PROFILE_BUS);
+        long long tenureBefore = busStats[transaction].busCycles;
+        long long done = scheduleSplit(coreId, transaction, cycles, after);
+        cores[coreId].busCycles += busStats[transaction].busCycles - tenureBefore;
+        PROFILE_LEAVE(profiler);
+        return done;
+    }
+    PROFILE_ENTER(profiler, PROFILE_BUS);
+
+    if (busFree) busNextFree = globalCycle;
+    busFree = false;
+    busOwner = coreId;
+    busTransaction = transaction;
+
+    BusTransactionStats &stats = busStats[transaction];
+    stats.count++;
+    stats.busCycles += cycles;
+    cores[coreId].busCycles += cycles;
+    bookBusWindow(coreId, busNextFree, cycles);
+    if (usesMemory(transaction)) stats.memoryCycles += cycles;
+    stats.queueCycles += busNextFree - globalCycle;
+    busNextFree += cycles;
+    stats.latencyCycles += busNextFree - globalCycle;
+    PROFILE_LEAVE(profiler);
+    return busNextFree;
+}
+
+// Split-bus timing of one transaction granted at globalCycle. It costs the
+// same as on the atomic bus when nothing else is in flight: one address
+// cycle, then for memory transactions the memory access, with the block
+// moving over the data bus during the last min(transfer, cycles - 1) cycles
+// (before the access, for writebacks). Cache-to-cache transfers use the data
+// bus for the rest of their cost.
+template <typename Address>
+long long BasicCacheSimulator<Address>::scheduleSplit(int coreId, BusTransaction transaction, int cycles,
+                                                     long long after) {
+    BusTransactionStats &stats = busStats[transaction];
+    long long grant = std::max(globalCycle, addressBusFree);
+    addressBusFree = grant + 1;
+    long long ready = std::max(grant + 1, after);
+
+    int dataCycles = cycles - 1;
+    long long done, dataStart;
+    if (!usesMemory(transaction)) {
+        dataStart = reserveDataBus(ready, dataCycles);
+        done = dataStart + dataCycles;
+    } else {
+        dataCycles = std::min(2 * (blockSize / 4), cycles - 1);
+        int accessCycles = cycles - 1 - dataCycles;
+        // Requests are served in grant order by whichever slot frees first
+        std::vector<long long>::iterator slot = std::min_element(memorySlotFree.begin(), memorySlotFree.end());
+        long long start;
+        if (isWriteBack(transaction)) {
+            dataStart = reserveDataBus(ready, dataCycles);
+            start = std::max(dataStart + dataCycles, *slot);
+            done = start + accessCycles;
         } else {
-            core.finished = true;
-            debugPrint("Core " + std::to_string(i) + " trace file empty");
+            start = std::max(ready, *slot);
+            dataStart = reserveDataBus(start + accessCycles, dataCycles);
+            done = dataStart + dataCycles;
         }
-        core.finished = false;
-        core.extime = 0;
-        core.idletime = 0;
-        
-        // Initialize statistics
-        core.totalInstructions = 0;
-        core.readCount = 0;
-        core.writeCount = 0;
-        core.missCount = 0;
-        core.hitCount = 0;
-        core.evictionCount = 0;
-        core.writebackCount = 0;
-        core.busInvalidations = 0;
-        core.dataTraffic = 0;
-        
-        cores.emplace_back(std::move(core));  // Use emplace_back to avoid unnecessary copies
+        stats.memoryCycles += done - start;
+        *slot = done;
     }
+    bookBusWindow(coreId, grant, 1);
+    bookBusWindow(coreId, dataStart, dataCycles);
+
+    stats.count++;
+    stats.busCycles += 1 + dataCycles;
+    stats.latencyCycles += done - globalCycle;
+    stats.queueCycles += (done - globalCycle) - cycles;
+    return done;
+}
+
+// Remember when the bus works for coreId, so interval rows can count each
+// cycle of tenure in the interval it falls in
+template <typename Address>
+void BasicCacheSimulator<Address>::bookBusWindow(int coreId, long long start, long long cycles) {
+    if (!intervals.isOpen() || cycles <= 0) return;
+    std::vector<std::pair<long long, long long> > &windows = cores[coreId].busWindows;
+    if (!windows.empty() && windows.back().second == start) windows.back().second += cycles;
+    else windows.push_back(std::make_pair(start, start + cycles));
 }
 
-CacheSimulator::~CacheSimulator() {
-    // Close trace files
-    for (auto &core : cores) {
-        if (core.trace && core.trace->is_open())
-            core.trace->close();
+// Functional warming's stand-in for occupyBus: the completion cycle of a
+// transaction issued at warmClock, with nothing counted. The atomic bus
+// queues transactions back to back. The split bus takes one address cycle
+// each, and memory transactions then wait for a request slot; data bus
+// conflicts are left out.
+template <typename Address>
+long long BasicCacheSimulator<Address>::scheduleWarm(BusTransaction transaction, int cycles, long long after) {
+    long long grant = std::max(warmClock, warmBusFree);
+    if (!splitBus) {
+        warmBusFree = grant + cycles;
+        return warmBusFree;
     }
+    warmBusFree = grant + 1;
+    long long ready = std::max(grant + 1, after);
+    if (!usesMemory(transaction)) return ready + cycles - 1;
+    std::vector<long long>::iterator slot = std::min_element(warmSlots.begin(), warmSlots.end());
+    *slot = std::max(ready, *slot) + cycles - 1;
+    return *slot;
 }
 
-void CacheSimulator::debugPrint(const std::string& message) {
-    if (debugMode) {
-        std::cout << "[Cycle " << globalCycle << "] " << message << std::endl;
+// Reserve the earliest window of the given length on the data bus that starts
+// at or after ready, and return its start. Windows never overlap, so they are
+// sorted by end as well as start.
+template <typename Address>
+long long BasicCacheSimulator<Address>::reserveDataBus(long long ready, int cycles) {
+    while (!dataBusBusy.empty() && dataBusBusy.begin()->second <= globalCycle) {
+        dataBusBusy.erase(dataBusBusy.begin());
+    }
+    long long start = ready;
+    for (std::map<long long, long long>::iterator it = dataBusBusy.begin(); it != dataBusBusy.end(); ++it) {
+        if (it->second <= start) continue;
+        if (it->first >= start + cycles) break;
+        start = it->second;
     }
+    if (cycles > 0) dataBusBusy[start] = start + cycles;
+    return start;
 }
 
-void CacheSimulator::runSimulation() {
-    // Continue until every core has finished processing its trace
-    while (!std::all_of(cores.begin(), cores.end(), [](const CoreState &cs){ return cs.finished; })) {
-        debugPrint("======= Starting cycle " + std::to_string(globalCycle) + " =======");
-        if (busFree) {
-            debugPrint("Bus is free");
-        } else {
-            debugPrint("Bus is owned by Core " + std::to_string(busOwner));
+template <typename Address>
+void BasicCacheSimulator<Address>::addressTooWide(int coreId) const {
+    std::ostringstream message;
+    message << "core " << coreId << " references " << addressToString(cores[coreId].current.address())
+            << ", which needs --address-bits 64";
+    throw std::runtime_error(message.str());
+}
+
+// Finish the current reference of a core and fetch its next one. The core
+// may act again at cycle nextReady.
+template <typename Address>
+void BasicCacheSimulator<Address>::completeReference(int coreId, long long nextReady) {
+    PROFILE_ENTER(profiler, PROFILE_STATS);
+    CoreState &core = cores[coreId];
+    core.totalInstructions++;
+    completedReferences++;
+    if (core.current.op() == WRITE) core.writeCount++;
+    else core.readCount++;
+    core.missPending = false;
+    core.readyAt = nextReady;
+
+    PROFILE_ENTER(profiler, PROFILE_TRACE);
+    core.hasCurrent = core.trace->next(core.current);
+    PROFILE_LEAVE(profiler);
+    if (core.hasCurrent) {
+        core.consumed++;
+    } else {
+        core.finished = true;
+        TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, coreId, TE_CORE_DONE, 0);
+    }
+    PROFILE_LEAVE(profiler);
+}
+
+// Invalidate every other core's copy of address. Returns the number of
+// copies invalidated. If coreId holds the block it becomes the owner.
+template <typename Address>
+int BasicCacheSimulator<Address>::invalidateOthers(int coreId, Address address) {
+    PROFILE_ENTER(profiler, PROFILE_COHERENCE);
+    Address block = blockOf(address);
+    DirectoryEntry* entry = directory.lookup(block);
+    if (!entry) {
+        PROFILE_LEAVE(profiler);
+        return 0;
+    }
+
+    int invalidated = 0;
+    bool keep = directory.hasSharer(*entry, coreId);
+    for (int j = directory.nextSharer(*entry, 0); j >= 0; ) {
+        int next = directory.nextSharer(*entry, j + 1);
+        if (j != coreId) {
+            PROFILE_COUNT(profiler, PC_SNOOPS, 1);
+            Line* line = cores[j].cache.findLine(address);
+            TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, j, TE_INVALIDATE, address,
+                        line->getState(), INVALID, coreId);
+            cores[j].cache.setState(*line, INVALID);
+            directory.removeSharer(block, *entry, j);
+            hotBlocks.record(HOT_INVALIDATION, block, coreId, j);
+            cores[j].busInvalidations++; // counted on the core that loses the copy
+            invalidated++;
         }
-        
-        // For this cycle, if the bus is free try to give a turn to one core
-        globalCycle++; //increment global cycle for each cycle
-        bool executed = false;
+        j = next;
+    }
+    if (keep) entry->owner = coreId;
+    totalInvalidations += invalidated;
+    PROFILE_LEAVE(profiler);
+    return invalidated;
+}
+
+// A write hit on a SHARED line. No block moves, but as in the original
+// simulator each invalidated copy counts a block of the writer's traffic.
+template <typename Address>
+void BasicCacheSimulator<Address>::invalidateSharers(int coreId, Address address) {
+    long long bytes = (long long)invalidateOthers(coreId, address) * blockSize;
+    cores[coreId].dataTraffic += bytes;
+    totalBusTraffic += bytes;
+}
+
+//
+// Data checking. Only the first word of each block is used: it holds the
+// version of the last write the copy has seen.
+//
+template <typename Address>
+void BasicCacheSimulator<Address>::loadLineData(int coreId, Line& line, Address address) {
+    if (!checkData) return;
+    auto it = memoryData.find(address & ~(Address)(blockSize - 1));
+    uint32_t version = (it == memoryData.end()) ? 0 : it->second;
+    std::memcpy(cores[coreId].cache.lineData(line), &version, sizeof(version));
+}
+
+template <typename Address>
+void BasicCacheSimulator<Address>::copyLineData(int toCore, Line& to, int fromCore, Line& from) {
+    if (!checkData) return;
+    std::memcpy(cores[toCore].cache.lineData(to), cores[fromCore].cache.lineData(from), blockSize);
+}
+
+template <typename Address>
+void BasicCacheSimulator<Address>::writeBackLineData(int coreId, Line& line, Address address) {
+    if (!checkData) return;
+    uint32_t version;
+    std::memcpy(&version, cores[coreId].cache.lineData(line), sizeof(version));
+    memoryData[address & ~(Address)(blockSize - 1)] = version;
+}
+
+template <typename Address>
+void BasicCacheSimulator<Address>::checkLineData(int coreId, Line& line, Address address, bool isWrite) {
+    if (!checkData) return;
+    PROFILE_ENTER(profiler, PROFILE_DATA);
+    unsigned char* data = cores[coreId].cache.lineData(line);
+    Address block = address & ~(Address)(blockSize - 1);
+    uint32_t held;
+    std::memcpy(&held, data, sizeof(held));
+    auto it = latestData.find(block);
+    uint32_t expected = (it == latestData.end()) ? 0 : it->second;
+    if (held != expected) {
+        dataMismatches++;
+        TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, coreId, TE_DATA_MISMATCH, block,
+                    INVALID, INVALID, held);
+    }
+    if (isWrite) {
+        uint32_t version = ++dataVersion;
+        std::memcpy(data, &version, sizeof(version));
+        latestData[block] = version;
+    }
+    PROFILE_LEAVE(profiler);
+}
+
+// Make room for address in coreId's cache and fill it in the given state.
+// A MODIFIED victim is written back first, which puts a writeback on the bus
+// ahead of the fill.
+template <typename Address>
+typename BasicCacheSimulator<Address>::Line& BasicCacheSimulator<Address>::fillLine(int coreId, Address address, CacheLineState state) {
+    CoreState &core = cores[coreId];
+    Line &victim = core.cache.victimFor(address);
+    if (victim.valid) {
+        Address victimAddress = core.cache.blockAddress(core.cache.getSetIndex(address), victim);
+        core.evictionCount++;
+        TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, coreId, TE_EVICT, victimAddress, victim.getState());
+        Address victimBlock = blockOf(victimAddress);
+        directory.removeSharer(victimBlock, *directory.lookup(victimBlock), coreId);
+        if (victim.getState() == MODIFIED) {
+            writeBackLineData(coreId, victim, victimAddress);
+            TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, coreId, TE_WRITEBACK, victimAddress,
+                        MODIFIED, INVALID, WriteBackOnEviction);
+            occupyBus(coreId, WriteBackOnEviction, MEMORY_LATENCY);
+            core.writebackCount++;
+            core.dataTraffic += blockSize;
+            totalBusTraffic += blockSize;
+        }
+    }
+    core.cache.fillLine(victim, address, state);
+    if (parallel && !relaxed) victim.shared = sharedBlocks.isShared(blockOf(address));
+    DirectoryEntry &entry = directory.insert(blockOf(address));
+    directory.addSharer(entry, coreId);
+    entry.owner = (state == SHARED) ? -1 : coreId;
+    return victim;
+}
+
+//
+// Issue the bus transaction for a miss. The coherence actions take effect at
+// grant time; the requester then idles for the returned number of cycles.
+//
+template <typename Address>
+long long BasicCacheSimulator<Address>::issueReadMiss(int coreId, Address address) {
+    CoreState &core = cores[coreId];
+
+    // The lowest-numbered core holding the line supplies it
+    DirectoryEntry* entry = directory.lookup(blockOf(address));
+    int supplier = entry ? directory.nextSharer(*entry, 0) : -1;
+
+    if (supplier < 0) {
+        // Nobody has it: fetch from memory, take it EXCLUSIVE
+        Line &line = fillLine(coreId, address, EXCLUSIVE);
+        loadLineData(coreId, line, address);
+        checkLineData(coreId, line, address, false);
+        long long done = occupyBus(coreId, ReadFromMem, MEMORY_LATENCY);
+        core.dataTraffic += blockSize;
+        totalBusTraffic += blockSize;
+        TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, coreId, TE_MEMORY_READ, address, INVALID, EXCLUSIVE);
+        return done - globalCycle;
+    }
+
+    // Cache-to-cache transfer: 2 cycles per 4-byte word
+    PROFILE_COUNT(profiler, PC_SNOOPS, 1);
+    Line* supplierLine = cores[supplier].cache.findLine(address);
+    CacheLineState supplierState = supplierLine->getState();
+    int transferCycles = 2 * (blockSize / 4);
+    TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, coreId, TE_CACHE_TO_CACHE, address,
+                supplierState, SHARED, supplier);
+    hotBlocks.record(HOT_CACHE_TO_CACHE, blockOf(address), coreId, supplier);
+
+    // An E/M owner is the only holder, so it is the supplier; it drops to
+    // SHARED along with the new copy
+    if (supplierState != SHARED) cores[supplier].cache.setState(*supplierLine, SHARED);
+    Line &line = fillLine(coreId, address, SHARED);
+    copyLineData(coreId, line, supplier, *supplierLine);
+    checkLineData(coreId, line, address, false);
+    long long cycles = occupyBus(coreId, ReadCacheToCache, transferCycles) - globalCycle;
+    core.dataTraffic += blockSize;
+    totalBusTraffic += blockSize;
+
+    if (supplierState == MODIFIED) {
+        // The owner also writes the dirty block back; the requester does not
+        // wait for it, but the bus stays busy until it is done.
+        writeBackLineData(supplier, *supplierLine, address);
+        TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, supplier, TE_WRITEBACK, address,
+                    MODIFIED, SHARED, WriteBackOnOtherReadMiss);
+        occupyBus(supplier, WriteBackOnOtherReadMiss, MEMORY_LATENCY);
+        hotBlocks.record(HOT_WRITEBACK_ON_READ, blockOf(address), coreId, supplier);
+        cores[supplier].writebackCount++;
+        cores[supplier].dataTraffic += blockSize;
+        totalBusTraffic += blockSize;
+    }
+    return cycles;
+}
+
+template <typename Address>
+long long BasicCacheSimulator<Address>::issueWriteMiss(int coreId, Address address) {
+    CoreState &core = cores[coreId];
+
+    // A MODIFIED copy elsewhere has to reach memory before we read it. Only
+    // the owner can hold one.
+    long long writtenBack = 0;
+    DirectoryEntry* entry = directory.lookup(blockOf(address));
+    if (entry && entry->owner >= 0) {
+        int owner = entry->owner;
+        PROFILE_COUNT(profiler, PC_SNOOPS, 1);
+        Line* line = cores[owner].cache.findLine(address);
+        if (line->getState() == MODIFIED) {
+            writeBackLineData(owner, *line, address);
+            TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, owner, TE_WRITEBACK, address,
+                        MODIFIED, MODIFIED, WriteBackOnOtherWriteMiss);
+            writtenBack = occupyBus(owner, WriteBackOnOtherWriteMiss, MEMORY_LATENCY);
+            cores[owner].writebackCount++;
+            cores[owner].dataTraffic += blockSize;
+            totalBusTraffic += blockSize;
+        }
+    }
+
+    invalidateOthers(coreId, address);
+    Line &line = fillLine(coreId, address, MODIFIED);
+    loadLineData(coreId, line, address);
+    checkLineData(coreId, line, address, true);
+    TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, coreId, TE_MEMORY_READ, address, INVALID, MODIFIED);
+    long long done = occupyBus(coreId, ReadWithIntentToModify, MEMORY_LATENCY, writtenBack);
+    core.dataTraffic += blockSize;
+    totalBusTraffic += blockSize;
+    return done - globalCycle;
+}
+
+//
+// Advance one core at globalCycle. Shared by both engines: the per-cycle loop
+// calls it every cycle the core is ready, the event loop only at the cycles a
+// core actually has something to do.
+//
+template <typename Address>
+void BasicCacheSimulator<Address>::stepCore(int coreId, bool skipAhead) {
+    ProfileStep step(profiler);
+    CoreState &core = cores[coreId];
+    PROFILE_ENTER(profiler, PROFILE_BUS);
+    releaseBusIfDone();
+    PROFILE_LEAVE(profiler);
+
+    if (!fits(core.current)) addressTooWide(coreId);
+    Address address = core.current.address();
+    bool isWrite = (core.current.op() == WRITE);
+
+    if (!core.missPending) {
+        TRACE_EVENT(tracer, TRACE_ALL, globalCycle, coreId, TE_ACCESS, address, INVALID, INVALID, isWrite);
+
+        PROFILE_ENTER(profiler, PROFILE_LOOKUP);
+        Line* line = core.cache.findLine(address);
+        if (line) core.cache.touch(*line);
+        PROFILE_LEAVE(profiler);
+        if (line) {
+            // Hit: executes in 1 cycle
+            core.hitCount++;
+            core.extime++;
+            checkLineData(coreId, *line, address, isWrite);
+            CacheLineState before = line->getState();
+            if (isWrite) {
+                if (line->getState() == SHARED) {
+                    // Broadcast invalidation
+                    totalBusTransactions++;
+                    busStats[BroadCastInvalidate].count++;
+                    invalidateSharers(coreId, address);
+                }
+                core.cache.setState(*line, MODIFIED);
+            }
+            TRACE_EVENT(tracer, TRACE_ALL, globalCycle, coreId, TE_HIT, address, before, line->getState());
+            completeReference(coreId, globalCycle + 1);
+            return;
+        }
+
+        core.missCount++;
+        core.missPending = true;
+        TRACE_EVENT(tracer, TRACE_COHERENCE, globalCycle, coreId, TE_MISS, address, INVALID, INVALID, isWrite);
+    }
+
+    if (!busAvailable()) {
+        // Stall until the bus frees up. The event engine books the whole
+        // wait at once; the per-cycle engine comes back next cycle.
+        long long wait = skipAhead ? busWait() : 1;
+        PROFILE_COUNT(profiler, PC_BUS_STALLS, 1);
+        PROFILE_COUNT(profiler, PC_STALL_CYCLES, wait);
+        core.idletime += wait;
+        core.idleFrom = globalCycle;
+        core.readyAt = globalCycle + wait;
+        return;
+    }
+
+    PROFILE_ENTER(profiler, PROFILE_COHERENCE);
+    long long cycles = isWrite ? issueWriteMiss(coreId, address) : issueReadMiss(coreId, address);
+    PROFILE_LEAVE(profiler);
+    core.idletime += cycles;
+    core.idleFrom = globalCycle + 1;
+    core.extime++;
+    completeReference(coreId, globalCycle + cycles + 1);
+}
+
+// Reference engine: tick globalCycle one cycle at a time and visit every core.
+template <typename Address>
+void BasicCacheSimulator<Address>::runCycleLoop() {
+    while (!std::all_of(cores.begin(), cores.end(), [](const CoreState &cs){ return cs.finished; })) {
+        if (!atCycleBoundary()) return;
         for (int coreId = 0; coreId < numCores; coreId++) {
-            cout << "Core " << coreId << " is executing" << endl;
-            // if (globalCycle > busNextFree) {
-            //     busFree = true;
-            //     busOwner = -1;
-            // } // dont free here, owner will free the bus
             CoreState &core = cores[coreId];
-            if (core.finished) {
-                debugPrint("Core " + std::to_string(coreId) + " has finished execution");
-                continue;
+            if (!core.finished && core.readyAt == globalCycle) {
+                stepCore(coreId, false);
             }
+        }
+        globalCycle++;
+    }
+}
 
-            // If an instruction is available, process it
-            if (!core.currentLine.empty()) {
-                // If bus is not free, the core idles
-                // if (!busFree) {
-                //     core.idletime++;
-                //     debugPrint("Core " + std::to_string(coreId) + " is stalled waiting for bus (owner: Core " + 
-                //               std::to_string(busOwner) + ")");
-                //     continue;
-                // }
-                
-                // Mark bus busy for this core
-                // busFree = false;
-                // busOwner = coreId;
-                // debugPrint("Core " + std::to_string(coreId) + " acquired bus");
-                
-                std::istringstream iss(core.currentLine);
-                char op;
-                std::string addrStr;
-                iss >> op >> addrStr;
-                unsigned int address = std::stoul(addrStr, nullptr, 16);
-                
-                core.totalInstructions++;
-                debugPrint("Core " + std::to_string(coreId) + " processing: " + op + " " + addrStr);
-                
-                // Process read instruction
-                if (op == 'R') { //one TODO here
-                    core.readCount++;
-                    // Read Hit: if the address is in the core's cache and state is not INVALID
-                    if (core.cache.find(address) != core.cache.end() &&
-                        core.cache[address] != INVALID) {
-                        // Local Read hit: execute in 1 cycle
-                        core.hitCount++;
-                        core.extime += 1;
-                        globalCycle += 1;
-                        
-                        CacheLineState oldState = core.cache[address];
-                        // no state change required for local read hit
-                        debugPrint("Core " + std::to_string(coreId) + " READ HIT for address " + 
-                                  addrStr + " (state: " + stateToString(oldState) + ")");
-                    } else {
-                        // Read Miss, what if present and invalid?
-                        core.missCount++;
-                        debugPrint("Core " + std::to_string(coreId) + " READ MISS for address " + addrStr);
-                        
-                        // First check if any other core has the address
-                        bool foundInOther = false;
-                        int ownerCore = -1;
-                        CacheLineState otherState = INVALID;
-                        
-                        for (int j = 0; j < numCores; j++) { //checking if any other core has the address
-                            if (j == coreId) continue;
-                            if (cores[j].cache.find(address) != cores[j].cache.end() &&
-                                cores[j].cache[address] != INVALID) { //dont want invalid copy
-                                foundInOther = true;
-                                otherState = cores[j].cache[address];
-                                ownerCore = j;
-                                break;
-                            }
-                        }
-                        
-                        totalBusTransactions++;
-                        
-                        if (foundInOther) {
-                            // Cache-to-cache transfer
-                            int transferCycles = 2 * (blockSize / 4); // 2n cycles where n = blockSize/4
-                            
-                            debugPrint("Core " + std::to_string(coreId) + " found data in Core " + 
-                                      std::to_string(ownerCore) + " (state: " + stateToString(otherState) + ")");
-                            
-
-                            switch (otherState)
-                            {
-                                case SHARED: 
-                                {
-                                    // take data from other cache and set own state to shared
-                                    if (busFree) 
-                                    { //bus is free, capture it and send request
-                                        busFree = false;
-                                        busOwner = coreId;
-                                        debugPrint("Core " + std::to_string(coreId) + " acquired bus for cache-to-cache transfer");
-                                        busTransaction = ReadCacheToCache; // i am reading on my readmiss
-                                        busNextFree = globalCycle + transferCycles;
-                                        core.idletime++;
-                                        continue; //sent request just now, so stalling
-                                        break;
-                                    }
-                                    else // bus is busy
-                                    { //bus is not free
-                                        if (busOwner == coreId) // waiting on my own request, to check what type
-                                        {
-                                            if (globalCycle <= busNextFree) //my request not yet served, this logic is correct
-                                                                            // for any case of bus transaction type
-                                            {
-                                                core.idletime++;
-                                                continue;
-                                                break;
-                                            }
-                                            else //my request just served, to check what request was served
-                                            { 
-                                                switch (busTransaction) 
-                                                {
-                                                    case ReadCacheToCache:
-                                                    {
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.cache[address] = SHARED; // check here if need to evict some address
-                                                        core.extime++; //including this here but not very sure
-                                                        //update bus traffic stats
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        break; 
-                                                    }
-                                                    default:
-                                                    {
-                                                        // my other request was served, free the bus
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        continue; // current request in next cycle
-                                                        break;
-                                                    }
-
-                                                }   
-                                            }
-                                        }
-                                        else // i am waiting on someone else's request to be served
-                                        {
-                                            core.idletime++;
-                                            continue;
-                                            break;
-                                        }
-                                    }
-                                    break;
-                                }
-                                case EXCLUSIVE:
-                                {
-                                    if (busFree) //bus is free, capture and send request
-                                    {
-                                        busFree = false;
-                                        busOwner = coreId;
-                                        debugPrint("Core " + std::to_string(coreId) + " acquired bus for cache-to-cache transfer");
-                                        busNextFree = globalCycle + transferCycles;
-                                        core.idletime++;
-                                        continue; //sent request just now, so stalling
-                                        break;
-                                    }
-                                    else //bus is busy, see what request is on the bus
-                                    {
-                                        if (busOwner == coreId) // i am waiting on my own request to be served
-                                        {
-                                            if (globalCycle <= busNextFree) //my request not yet served
-                                            {
-                                                core.idletime++;
-                                                continue;
-                                                break;
-                                            }
-                                            else //my request just served, to check what request was served
-                                            {
-                                                switch (busTransaction) 
-                                                {
-                                                    case ReadCacheToCache:
-                                                    {
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.cache[address] = SHARED; // check here if need to evict some address
-                                                        core.extime++; //including this here but not very sure
-                                                        //update bus traffic stats
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        break; 
-                                                    }
-                                                    default:
-                                                    {
-                                                        // my other request was served, free the bus
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        continue; // current request in next cycle, so continue
-                                                        break;
-                                                    }
-                                                
-                                                }
-                                            }
-                                        }
-
-                                        else //waiting on someone else's request
-                                        {
-                                            core.idletime++;
-                                            continue;
-                                            break;
-                                        }
-                                    }
-                                    break;
-                                }
-                                case MODIFIED:
-                                {
-                                    if (busFree) //bus is free, take control and send request
-                                    {
-                                        busFree = false;
-                                        busOwner = coreId;
-                                        debugPrint("Core " + std::to_string(coreId) + " acquired bus for cache-to-cache transfer");
-                                        busNextFree = globalCycle + transferCycles;
-                                        core.idletime++;
-                                        continue; //sent request just now, so stalling
-                                        break;
-                                    }
-                                    else //bus busy, one TODO here
-                                    {
-                                        if (busOwner == coreId) // i am waiting on my own request to be served
-                                        {
-                                            if (globalCycle <= busNextFree) //my request not yet served
-                                            {
-                                                core.idletime++;
-                                                continue;
-                                                break;
-                                            }
-                                            else //my request just served, see which request was served
-                                            {
-                                                switch (busTransaction)
-                                                {
-                                                    case ReadCacheToCache:
-                                                    {
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.cache[address] = SHARED;
-                                                        core.extime++; //including this here but not very sure
-                                                        //update bus traffic stats
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        // have to write owner's copy back to memory
-                                                        int memAccessCycles = 100;
-                                                        busFree = false;
-                                                        busOwner = ownerCore;
-                                                        busNextFree = globalCycle + memAccessCycles;
-                                                        busTransaction = WriteBackOnOtherReadMiss;
-                                                        // some eviction logic, stats, etc.
-                                                        continue;
-                                                        break;
-                                                    }
-                                                    default:
-                                                    {
-                                                        // my other request was served, free the bus
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        continue; // current request in next cycle, so continue
-                                                        break;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        else //waiting on someone else's request
-                                        {
-                                            core.idletime++;
-                                            continue;
-                                            break;
-                                        }
-                                    }
-                                    break;
-                                }
-                            }
-
-                            // Extra cycle when data comes from an E or M state
-                            // if (otherState == EXCLUSIVE || otherState == MODIFIED) {
-                            //     transferCycles += 1;
-                            //     debugPrint("Extra cycle for E/M state transfer");
-                            // }
-                            
-                            // core.extime += transferCycles + 1; // +1 for execution after transfer
-                            // globalCycle += transferCycles + 1;
-                            
-                            // // After transfer, mark line in requester as SHARED
-                            // core.cache[address] = SHARED;
-                            
-                            // // If source was E or M, change it to S too
-                            // if (otherState == EXCLUSIVE || otherState == MODIFIED) {
-                            //     cores[ownerCore].cache[address] = SHARED;
-                            //     debugPrint("Core " + std::to_string(ownerCore) + " state changed to SHARED");
-                            // }
-                            
-                            // // Update bus traffic statistics
-                            // core.dataTraffic += blockSize;
-                            // totalBusTraffic += blockSize;
-                            
-                            // debugPrint("Cache-to-cache transfer complete (took " + 
-                            //           std::to_string(transferCycles) + " cycles)");
-                            // debugPrint("Core " + std::to_string(coreId) + " state now SHARED");
-                        } 
-                        else {
-                            // Data not found in any other cache: fetch from memory
-                            int memAccessCycles = 100;
-                            // core.idletime += memAccessCycles; //+100 for idle cycle
-                            // core.extime += 1;
-                            
-                            if (!busFree) // bus is busy
-                            {
-                                if (busOwner == coreId) { //i am the owner and waiting on my request
-                                    if (globalCycle <= busNextFree) //my request not yet complete
-                                    {
-                                        core.idletime++; //stall and move on
-                                        continue;
-                                    } 
-                                    else //my request just completed, check to see which request was served
-                                    {
-                                        switch (busTransaction)
-                                        {
-                                            case ReadFromMem:
-                                            {
-                                                busFree = true;
-                                                busOwner = -1;
-                                                core.cache[address] = EXCLUSIVE;
-                                                core.extime++; //including this here but not very sure
-                                                //update bus traffic stats
-                                                core.dataTraffic += blockSize;
-                                                totalBusTraffic += blockSize;
-                                                break;
-                                            }
-                                            default:
-                                            {
-                                                // my other request was served, free the bus
-                                                busFree = true;
-                                                busOwner = -1;
-                                                core.dataTraffic += blockSize;
-                                                totalBusTraffic += blockSize;
-                                                continue; // current request in next cycle, so continue
-                                                break;
-                                            }
-                                        }
-                                    }
-                                } 
-                                else 
-                                { //bus is busy due someone else's request
-                                    core.idletime++;
-                                    continue;
-                                }
-                            } 
-                            else  //bus is free to capture
-                            { //take ownership of bus and send request
-                                busFree = false;
-                                busOwner = coreId;
-                                busTransaction = ReadFromMem;
-                                busNextFree = globalCycle + memAccessCycles;
-                                core.idletime++; //including idle time here though not very sure
-                                continue;
-                            }
-                     // ********// globalCycle += memAccessCycles + 1;********
-                            
-                            // Set state to EXCLUSIVE, this to do when we get data from memory, for now processor should stall
-                            // core.cache[address] = EXCLUSIVE;
-                            // core.dataTraffic += blockSize;
-                            // totalBusTraffic += blockSize;
-                        }
-                    }
-                }
-                // Process write instruction
-                else if (op == 'W') {
-                    core.writeCount++;
-                    // Write Hit, all actions will be instantaneous
-                    if (core.cache.find(address) != core.cache.end() &&
-                        core.cache[address] != INVALID) {
-                        core.hitCount++;
-                        CacheLineState ownState = core.cache[address];
-                        
-                        debugPrint("Core " + std::to_string(coreId) + " WRITE HIT for address " + 
-                                  addrStr + " (state: " + stateToString(ownState) + ")");
-                        
-                        // If state is SHARED, send invalidations to other cores
-                        if (ownState == SHARED) {
-                            debugPrint("Sending invalidations to other cores with SHARED copies");
-                            totalBusTransactions++;
-                            
-                            for (int j = 0; j < numCores; j++) { //assuming this operation is instantaneously happening
-                                if (j == coreId) continue;
-                                if (cores[j].cache.find(address) != cores[j].cache.end() &&
-                                    cores[j].cache[address] != INVALID) {
-                                    // Invalidate other core's copy
-                                    CacheLineState prevState = cores[j].cache[address];
-                                    cores[j].cache[address] = INVALID;
-                                    totalInvalidations++;
-                                    cores[j].busInvalidations++; // what is this?
-                                    core.dataTraffic += blockSize;
-                                    totalBusTraffic += blockSize;
-                                    
-                                    debugPrint("Invalidated Core " + std::to_string(j) + 
-                                              " copy (was " + stateToString(prevState) + ")");
-                                }
-                            }
-                            // Then update own state to MODIFIED
-                            core.cache[address] = MODIFIED;
-                            core.extime += 1;
-                            // globalCycle += 1;
-                            
-                            debugPrint("Core " + std::to_string(coreId) + " state changed to MODIFIED");
-                        } else if (ownState == EXCLUSIVE) {
-                            // Write hit in EXCLUSIVE state takes 1 cycle, becomes MODIFIED, no need to send invalidate
-                            core.extime += 1;
-                            // globalCycle += 1;
-                            core.cache[address] = MODIFIED;
-                            
-                            debugPrint("Core " + std::to_string(coreId) + 
-                                      " state changed from EXCLUSIVE to MODIFIED");
-                        } else if (ownState == MODIFIED) {
-                            // Write hit in MODIFIED state takes 1 cycle
-                            core.extime += 1;
-                            // globalCycle += 1;
-                            debugPrint("Core " + std::to_string(coreId) + 
-                                      " remains in MODIFIED state");
-                        }
-                    } else { //some operations will take bus access, handle accordingly, write miss
-                        // Local Write Miss Happened
-                        core.missCount++;
-                        debugPrint("Core " + std::to_string(coreId) + " WRITE MISS for address " + addrStr);
-                        totalBusTransactions++;
-                        
-                        // Invalidate copies from other caches, if any
-                        bool foundInOther = false;
-                        bool canProceed = true;
-                        for (int j = 0; j < numCores; j++) {
-                            if (j == coreId) continue;
-                            if (cores[j].cache.find(address) != cores[j].cache.end() &&
-                                cores[j].cache[address] != INVALID) {
-                                foundInOther = true;
-                                int ownerCore = j;
-                                CacheLineState prevState = cores[j].cache[address];
-                                switch (prevState) 
-                                {
-                                    case SHARED:
-                                    {
-                                        //find all shared blocks, and invalidate their copies
-                                        vector<int> sharedCoreIndices;
-                                        for (int j = 0; j < numCores; j++) {
-                                            if (j==coreId) continue;
-                                            if (cores[j].cache.find(address) != cores[j].cache.end() &&
-                                                cores[j].cache[address] != INVALID) {
-                                                if (cores[j].cache[address] == SHARED) 
-                                                    sharedCoreIndices.push_back(j);  // Store index, not the object
-                                                }            
-                                        }
-                                        if (busFree) //bus is free, capture it and send req to memory
-                                        {
-                                            int memAccessCycles = 100;
-                                            busFree = false;
-                                            busOwner = coreId;
-                                            busNextFree = globalCycle + memAccessCycles;
-                                            busTransaction = ReadWithIntentToModify;
-                                            totalBusTransactions++;
-                                        }
-                                        else //bus is busy
-                                        {
-                                            if (busOwner == coreId) // i am waiting on my own request
-                                            {
-                                                if (globalCycle <= busNextFree) //my req not processed yet
-                                                {
-                                                    core.idletime ++;
-                                                    continue;
-                                                }
-                                                else //my req just processed, see which one
-                                                {
-                                                    switch (busTransaction) //useless to check
-                                                    { 
-                                                        case ReadWithIntentToModify:
-                                                        {
-                                                            busFree = true;
-                                                            busOwner = -1;
-                                                            core.cache[address] = MODIFIED;
-                                                            //key request processed, set other owner to I, and my copy to M
-                                                            cores[ownerCore].cache[address] = INVALID;
-                                                            core.dataTraffic += blockSize;
-                                                            totalBusTraffic += blockSize;
-                                                            break;
-                                                        }
-                                                        default:
-                                                        {
-                                                            busFree = true;
-                                                            busOwner = -1;
-                                                            core.dataTraffic += blockSize;
-                                                            totalBusTraffic += blockSize;
-                                                            continue; // current request in next cycle, so continue
-                                                            break;
-                                                        }
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        for (auto idx : sharedCoreIndices) {
-                                            assert(cores[idx].cache[address] == SHARED);
-                                            cores[idx].cache[address] = INVALID;
-                                        } //done, all shared blocks set to invalid
-                                        break;
-                          }
-                                    case EXCLUSIVE:
-                                    { //have to fetch data from memory
-                                        // broadcast signal rwitm, other cache will invalidate their copy
-                                        if (busFree) //bus is free, capture it and send req to memory
-                                        {
-                                            int memAccessCycles = 100;
-                                            busFree = false;
-                                            busOwner = coreId;
-                                            busNextFree = globalCycle + memAccessCycles;
-                                            busTransaction = ReadWithIntentToModify;
-                                            totalBusTransactions++;
-                                        }
-                                        else //bus is busy
-                                        {
-                                            if (busOwner == coreId) // i am waiting on my own request
-                                            {
-                                                if (globalCycle <= busNextFree) //my req not processed yet
-                                                {
-                                                    core.idletime ++;
-                                                    continue;
-                                                }
-                                                else //my req just processed, see which one
-                                                {
-                                                    switch (busTransaction) 
-                                                    { 
-                                                        case ReadWithIntentToModify:
-                                                        {
-                                                            busFree = true;
-                                                            busOwner = -1;
-                                                            core.cache[address] = MODIFIED;
-                                                            //key request processed, set other owner to I, and my copy to M
-                                                            cores[ownerCore].cache[address] = INVALID;
-                                                            core.dataTraffic += blockSize;
-                                                            totalBusTraffic += blockSize;
-                                                            break;
-                                                        }
-                                                        default: // my other requests were served, free the bus for now
-                                                        {
-                                                            busFree = true;
-                                                            busOwner = -1;
-                                                            core.dataTraffic += blockSize;
-                                                            totalBusTraffic += blockSize;
-                                                            continue; // current request in next cycle, so continue
-                                                            break;
-                                                        }
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        
-                                        // assert(cores[ownerCore].cache[address] == INVALID);
-                                        //some invalidation stats
-                                        break;
-                                    }
-                                    case MODIFIED:
-                                    {
-                                        // write back from owner cache to memory
-                                        // next implement copy from memory and write into current cache
-                                        if (!busFree)
-                                        {
-                                            core.idletime++;
-                                            canProceed = false; // 
-                                            break;
-                                        }
-                                        busFree = false;
-                                        busOwner = ownerCore;
-                                        busNextFree = globalCycle + 100; //100 cycles to write back to memory
-                                        busTransaction = WriteBackOnOtherWriteMiss;
-                                        cores[ownerCore].cache[address] = INVALID; // invalidate the copy in owner core, 
-                                         //strictly this should be done after the bus is freed, but ig ok for now
-                                        totalBusTransactions++;
-                                        break;
-                                    }
-                                }
-                                
-                                debugPrint("Invalidated Core " + std::to_string(j) + 
-                                          " copy (was " + stateToString(prevState) + ")");
-                            }
-                        }
-                        if (!canProceed) continue; // cant issue request, move on
-                        // Fetch data from memory, didnt find in any other cache
-                        int memAccessCycles = 100;
-                        // assert(!foundInOther);
-                        if (busFree) //bus is free, capture it and send req to memory
-                        {
-                            busFree = false;
-                            busOwner = coreId;
-                            busNextFree = globalCycle + memAccessCycles;
-                        }
-                        else //bus is busy
-                        {
-                            if (busOwner == coreId) // i am waiting on my own request
-                            {
-                                if (globalCycle <= busNextFree) //my req not processed yet
-                                {
-                                    core.idletime ++;
-                                    continue;
-                                }
-                                else //my req just processed
-                                {
-                                    busFree = true;
-                                    busOwner = -1;
-                                    core.cache[address] = MODIFIED;
-                                    core.dataTraffic += blockSize;
-                                    core.extime++;
-                                    totalBusTraffic += blockSize;
-                                }
-                            }
-                            else //i am waiting on someone else's req
-                            {
-                                core.idletime ++;
-                                continue;
-                            }
-                        }
-                        // core.extime += memAccessCycles + 1;
-                        // globalCycle += memAccessCycles + 1;
-                        
-                        // Update bus traffic for memory fetch
-                        // core.dataTraffic += blockSize;
-                        // totalBusTraffic += blockSize;
-                        
-                        // After write miss, update own state to MODIFIED
-                        // assert(core.cache[address] == MODIFIED);
-                        
-                        debugPrint("Memory fetch and modify complete (took " + 
-                                  std::to_string(memAccessCycles+1) + " cycles)");
-                        debugPrint("Core " + std::to_string(coreId) + " state now MODIFIED");
-                    }
-                }
-                
-                // Mark bus as free
-                assert(busFree = true); // bus should be free if reached here
-                // busFree = true;
-                debugPrint("Core " + std::to_string(coreId) + " released the bus");
-                busOwner = -1;
-                executed = true;
-                
-                // Read next line for this core
-                if (!std::getline(*core.trace, core.currentLine)) {
-                    core.finished = true;
-                    debugPrint("Core " + std::to_string(coreId) + " has no more instructions");
-                } else {
-                    debugPrint("Core " + std::to_string(coreId) + " next instruction: " + core.currentLine);
-                }
+// Event engine: a min-queue of (ready cycle, core id) jumps globalCycle
+// straight to the next cycle at which some core can act. Ties pop in core id
+// order, which is the order the per-cycle loop visits cores in.
+template <typename Address>
+void BasicCacheSimulator<Address>::runEventLoop(long long maxReferences) {
+    long long stopAfter = maxReferences < LLONG_MAX - completedReferences ? completedReferences + maxReferences : LLONG_MAX;
+    typedef std::pair<long long, int> Event;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+    for (int coreId = 0; coreId < numCores; coreId++) {
+        if (!cores[coreId].finished) events.push(Event(cores[coreId].readyAt, coreId));
+    }
+
+    bool first = true;
+    while (!events.empty()) {
+        Event ev = events.top();
+        if (first || ev.first != globalCycle) {
+            // Every event of the previous cycle has run
+            globalCycle = ev.first;
+            first = false;
+            if (completedReferences >= stopAfter || !atCycleBoundary()) return;
+        }
+        events.pop();
+        stepCore(ev.second, true);
+        if (!cores[ev.second].finished) {
+            events.push(Event(cores[ev.second].readyAt, ev.second));
+        }
+    }
+}
+
+// Thread pool of the parallel engine: one thread per core. run() hands each
+// threaded core to its own thread, does the inline ones on the calling
+// thread meanwhile, and returns once all are done, so nothing the caller
+// does afterwards overlaps with them.
+class CoreWorkers {
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<char> flagged;
+    std::function<void(int)> work;
+    unsigned long generation;
+    int remaining;
+    bool quit;
+
+    void loop(int coreId) {
+        unsigned long seen = 0;
+        for (;;) {
+            std::function<void(int)> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+                if (!flagged[coreId]) continue;
+                job = work;
             }
+            job(coreId);
+            std::lock_guard<std::mutex> lock(mutex);
+            flagged[coreId] = 0;
+            if (--remaining == 0) done.notify_one();
         }
-        
-        // If no core executed (e.g., all waiting for the bus), advance the clock
-        // if (!executed) {
-        //     globalCycle++;
-        //     debugPrint("No execution this cycle, advancing global clock");
-        //     for (int coreId = 0; coreId < numCores; coreId++) {
-        //         if (!cores[coreId].finished) {
-        //             cores[coreId].idletime++;
-        //             debugPrint("Core " + std::to_string(coreId) + " idle time increased");
-        //         }
-        //     }
-        // }
     }
-    
+
+public:
+    explicit CoreWorkers(int numCores) : flagged(numCores, 0), generation(0), remaining(0), quit(false) {
+        for (int i = 0; i < numCores; i++) threads.emplace_back(&CoreWorkers::loop, this, i);
+    }
+
+    ~CoreWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads) thread.join();
+    }
+
+    void run(const std::vector<int>& threaded, const std::vector<int>& inlined, const std::function<void(int)>& job) {
+        if (!threaded.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int coreId : threaded) flagged[coreId] = 1;
+            work = job;
+            remaining = (int)threaded.size();
+            generation++;
+            wake.notify_all();
+        }
+        for (int coreId : inlined) job(coreId);
+        if (!threaded.empty()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return remaining == 0; });
+        }
+    }
+};
+
+//
+// Parallel engine. Bus transactions, and in strict mode every reference to a
+// block that more than one core's trace touches, are events handled on this
+// thread in (cycle, core id) order exactly as in runEventLoop. Between
+// events, each core's thread runs it ahead through hits that nothing else can
+// affect. An invalidation never changes the recency order of valid lines, so
+// applying those hits early leaves the same caches behind.
+//
+// The two kinds of work never overlap: events are processed until the next
+// one could come before a core whose run-ahead is pending, then the pending
+// cores run ahead together.
+//
+// A thread is only woken for a core whose recent run-aheads averaged at
+// least PARALLEL_MIN_RUN references; shorter ones cost less than the wakeup
+// and run on this thread instead, as everything does on a single-CPU host.
+static const double PARALLEL_MIN_RUN = 256;
+
+template <typename Address>
+void BasicCacheSimulator<Address>::runParallelLoop() {
+    CoreWorkers workers(numCores);
+    bool threads = std::thread::hardware_concurrency() > 1;
+    if (!relaxed) findSharedBlocks(workers);
+
+    typedef std::pair<long long, int> Event;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+    std::vector<int> pending, threaded, inlined;
+    std::vector<long long> completed(numCores, 0);
+    std::vector<double> averageRun(numCores, PARALLEL_MIN_RUN); // moving average of run-ahead lengths
+    for (int coreId = 0; coreId < numCores; coreId++) {
+        if (!cores[coreId].finished) pending.push_back(coreId);
+    }
+
+    for (;;) {
+        long long bound = LLONG_MAX;
+        for (int coreId : pending) bound = std::min(bound, cores[coreId].readyAt);
+        if (!pending.empty() && (events.empty() || events.top().first >= bound)) {
+            // Relaxed mode lets cores run through shared blocks as far as
+            // quantum cycles past the earliest event that could touch them
+            long long earliest = events.empty() ? bound : std::min(bound, events.top().first);
+            long long horizon = relaxed ? (earliest > LLONG_MAX - quantum ? LLONG_MAX : earliest + quantum) : LLONG_MAX;
+            threaded.clear();
+            inlined.clear();
+            for (int coreId : pending) {
+                if (threads && averageRun[coreId] >= PARALLEL_MIN_RUN) threaded.push_back(coreId);
+                else inlined.push_back(coreId);
+            }
+            // One thread's work is better done here than handed over
+            if (threaded.size() == 1) {
+                inlined.push_back(threaded[0]);
+                threaded.clear();
+            }
+            workers.run(threaded, inlined, [&](int coreId) { completed[coreId] = runAhead(coreId, horizon); });
+            for (int coreId : pending) {
+                PROFILE_COUNT(profiler, PC_RUN_AHEAD, completed[coreId]);
+                completedReferences += completed[coreId];
+                averageRun[coreId] = 0.875 * averageRun[coreId] + 0.125 * completed[coreId];
+                if (!cores[coreId].finished) events.push(Event(cores[coreId].readyAt, coreId));
+            }
+            pending.clear();
+        }
+        if (events.empty()) break;
+
+        Event ev = events.top();
+        events.pop();
+        globalCycle = ev.first;
+        CoreState &core = cores[ev.second];
+        long long before = core.totalInstructions;
+        stepCore(ev.second, true);
+        if (core.finished) continue;
+        // A core stalled on the bus retries the same reference; after
+        // anything else the next reference may be one it can run ahead on
+        if (core.totalInstructions == before) events.push(Event(core.readyAt, ev.second));
+        else pending.push_back(ev.second);
+    }
+}
+
+// Run one core through consecutive hits it can take on its own: read hits,
+// and write hits on EXCLUSIVE or MODIFIED lines; in strict mode only on
+// blocks private to it, in relaxed mode up to horizon. Stops at the first
+// reference that needs the bus or the main thread. Runs on a worker thread,
+// so it touches nothing outside this core. Returns the references completed.
+template <typename Address>
+long long BasicCacheSimulator<Address>::runAhead(int coreId, long long horizon) {
+    CoreState &core = cores[coreId];
+    long long completed = 0;
+    while (!core.missPending && core.readyAt < horizon && fits(core.current)) {
+        Address address = core.current.address();
+        bool isWrite = (core.current.op() == WRITE);
+        Line* line = core.cache.findLine(address);
+        if (!line || (line->shared && !relaxed) || (isWrite && line->getState() == SHARED)) break;
+
+        core.hitCount++;
+        core.extime++;
+        core.cache.touch(*line);
+        if (isWrite) core.cache.setState(*line, MODIFIED);
+        core.totalInstructions++;
+        if (isWrite) core.writeCount++;
+        else core.readCount++;
+        core.readyAt++;
+        completed++;
+
+        core.hasCurrent = core.trace->next(core.current);
+        if (!core.hasCurrent) {
+            core.finished = true;
+            break;
+        }
+        core.consumed++;
+    }
+    return completed;
+}
+
+// Slots of the shared-block filter: 16 MB, so a few million distinct blocks
+// cost a private one its run-ahead only rarely
+static const int SHARED_FILTER_BITS = 22;
+
+// Strict mode's notion of private: a block is shared if the traces of two
+// different cores reference it. Each thread adds the blocks of its own
+// core's trace, read again from the same records the cores replay, to a
+// filter whose size does not depend on the traces.
+template <typename Address>
+void BasicCacheSimulator<Address>::findSharedBlocks(CoreWorkers& workers) {
+    sharedBlocks.reset(SHARED_FILTER_BITS);
+    std::vector<int> all;
+    for (int coreId = 0; coreId < numCores; coreId++) {
+        if (!cores[coreId].finished) all.push_back(coreId); // finished already: empty or missing trace
+    }
+    workers.run(all, std::vector<int>(), [&](int coreId) {
+        std::unique_ptr<TraceReader> trace =
+            traceSet ? traceSet->openReader(coreId) : TraceReader::openCore(tracePrefix, coreId);
+        TraceRecord record;
+        while (trace->next(record)) sharedBlocks.add(blockOf(record.address()), coreId);
+    });
+}
+
+//
+// Sampled simulation after SMARTS (Wunderlich et al., ISCA 2003). Most of the
+// trace only goes through functional warming, which keeps the caches and the
+// coherence state exact but models no time, or with sampleFastForward is
+// skipped outright. Every samplePeriod references, the bus is drained and the
+// event engine runs sampleWarmup references per core to bring queues and
+// timing back to a steady state, then measures the next sampleUnit.
+//
+// Cores do not progress at the same rate (bus arbitration favours low ids),
+// and where they are in their traces relative to each other decides which
+// blocks they contend for. Functional warming therefore interleaves the cores
+// by a rough model of the bus (see warmCores), so that their relative
+// progress follows the contention as a detailed run's would; the fastest core
+// covers the full period. Fast-forward cannot: each core skips references in
+// proportion to what it got done in the last window.
+//
+template <typename Address>
+void BasicCacheSimulator<Address>::runSampled() {
+    int between = samplePeriod - sampleWarmup - sampleUnit;
+    std::vector<double> share(numCores, 1.0);
+    std::vector<long long> windowStart(numCores);
+    long long periodStart = 0;
+    for (;;) {
+        warming = true;
+        for (int coreId = 0; coreId < numCores; coreId++) {
+            CoreState &core = cores[coreId];
+            if (core.finished || !sampleFastForward) continue;
+            skipReferences(coreId, (long long)(between * share[coreId] + 0.5));
+        }
+        if (!sampleFastForward) warmCores(between);
+        warming = false;
+
+        int active = 0;
+        for (const CoreState &core : cores) active += !core.finished;
+        if (active == 0 || stopped) break;
+
+        quiesce();
+        for (int coreId = 0; coreId < numCores; coreId++) windowStart[coreId] = cores[coreId].totalInstructions;
+        runEventLoop((long long)sampleWarmup * active);
+        if (stopped) break;
+
+        SampleUnit before;
+        before.references = completedReferences;
+        before.misses = before.idleCycles = 0;
+        for (const CoreState &core : cores) {
+            before.misses += core.missCount;
+            before.idleCycles += core.idletime;
+        }
+        before.busTraffic = totalBusTraffic;
+        before.cycles = globalCycle;
+
+        runEventLoop((long long)sampleUnit * active);
+        SampleUnit unit;
+        unit.references = completedReferences - before.references;
+        unit.misses = -before.misses;
+        unit.idleCycles = -before.idleCycles;
+        for (const CoreState &core : cores) {
+            unit.misses += core.missCount;
+            unit.idleCycles += core.idletime;
+        }
+        unit.busTraffic = totalBusTraffic - before.busTraffic;
+        // The event loop stops on the first cycle of the next reference, or
+        // returns with every core done; then the unit ends with the last one
+        long long end = globalCycle;
+        if (std::all_of(cores.begin(), cores.end(), [](const CoreState &cs){ return cs.finished; })) {
+            for (const CoreState &core : cores) end = std::max(end, core.readyAt);
+        }
+        unit.cycles = end - before.cycles;
+        long long covered = completedReferences + skippedReferences;
+        unit.periodReferences = covered - periodStart;
+        // A unit cut short by the end of the traces is too small to trust;
+        // its period counts towards the previous unit
+        if (unit.references >= (long long)sampleUnit * active) {
+            samples.push_back(unit);
+            periodStart = covered;
+        }
+
+        long long fastest = 0;
+        for (int coreId = 0; coreId < numCores; coreId++) {
+            fastest = std::max(fastest, cores[coreId].totalInstructions - windowStart[coreId]);
+        }
+        for (int coreId = 0; coreId < numCores; coreId++) {
+            long long done = cores[coreId].totalInstructions - windowStart[coreId];
+            share[coreId] = fastest > 0 ? (double)done / fastest : 1.0;
+        }
+        if (stopped) break;
+    }
+    // References after the last unit are represented by it
+    if (!samples.empty()) samples.back().periodReferences += completedReferences + skippedReferences - periodStart;
+}
+
+// Fast-forward: drop the current reference and count - 1 after it without
+// simulating them
+template <typename Address>
+void BasicCacheSimulator<Address>::skipReferences(int coreId, long long count) {
+    CoreState &core = cores[coreId];
+    if (count <= 0 || !core.hasCurrent) return;
+    uint64_t skipped = 1 + core.trace->skip(count - 1);
+    core.consumed += skipped - 1;
+    skippedReferences += skipped;
+    core.missPending = false;
+    core.hasCurrent = core.trace->next(core.current);
+    if (core.hasCurrent) core.consumed++;
+    else core.finished = true;
+}
+
+// Functional warming until the fastest core has covered between references.
+// Each core keeps a clock of its own: a hit takes a cycle, and a miss waits
+// for the bus (the address bus when split), which the lowest-numbered
+// waiting core gets as in the event engine, then for its transactions as
+// scheduleWarm times them. Nothing is counted towards the estimates; the
+// clocks only decide the order, so sharing patterns whose misses depend on
+// the cores' relative progress warm the way a detailed run would go.
+template <typename Address>
+void BasicCacheSimulator<Address>::warmCores(int between) {
+    typedef std::pair<long long, int> Event;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event> > clocks;
+    for (int coreId = 0; coreId < numCores; coreId++) {
+        if (!cores[coreId].finished) clocks.push(Event(globalCycle, coreId));
+    }
+    warmBusFree = globalCycle;
+    warmSlots.assign(memorySlotFree.size(), globalCycle);
+    std::vector<int> warmed(numCores, 0);
+    while (!clocks.empty()) {
+        warmClock = clocks.top().first;
+        int coreId = clocks.top().second;
+        clocks.pop();
+        CoreState &core = cores[coreId];
+        if (!fits(core.current)) addressTooWide(coreId);
+        // A miss left waiting for the bus by a detailed window is counted already
+        Line* line = core.missPending ? nullptr : core.cache.findLine(core.current.address());
+        if (!line && warmBusFree > warmClock) {
+            clocks.push(Event(warmBusFree, coreId));
+            continue;
+        }
+        long long next = warmReference(coreId, line);
+        if (++warmed[coreId] >= between) return;
+        if (!core.finished) clocks.push(Event(next, coreId));
+    }
+}
+
+// Functional warming of one reference whose line warmCores looked up (null
+// for a miss): the same cache and coherence updates as stepCore, with
+// occupyBus replaced by scheduleWarm so no time passes. Returns the cycle
+// the core goes on at on warmCores's clocks.
+template <typename Address>
+long long BasicCacheSimulator<Address>::warmReference(int coreId, Line* line) {
+    CoreState &core = cores[coreId];
+    Address address = core.current.address();
+    bool isWrite = (core.current.op() == WRITE);
+    long long next = warmClock + 1;
+    if (line) {
+        core.hitCount++;
+        core.cache.touch(*line);
+        checkLineData(coreId, *line, address, isWrite);
+        if (isWrite) {
+            if (line->getState() == SHARED) invalidateSharers(coreId, address);
+            core.cache.setState(*line, MODIFIED);
+        }
+    } else {
+        if (!core.missPending) core.missCount++;
+        next = globalCycle + 1 + (isWrite ? issueWriteMiss(coreId, address) : issueReadMiss(coreId, address));
+    }
+    core.extime++;
+    completeReference(coreId, core.readyAt);
+    return next;
+}
+
+// Let every outstanding bus transaction finish and line all cores up at the
+// cycle the bus goes idle, so a detailed window starts from an empty bus.
+template <typename Address>
+void BasicCacheSimulator<Address>::quiesce() {
+    long long idle = globalCycle;
+    for (const CoreState &core : cores) {
+        if (!core.finished) idle = std::max(idle, core.readyAt);
+    }
+    if (!busFree) idle = std::max(idle, busNextFree);
+    idle = std::max(idle, addressBusFree);
+    for (long long slot : memorySlotFree) idle = std::max(idle, slot);
+    for (const std::pair<const long long, long long> &window : dataBusBusy) idle = std::max(idle, window.second);
+
+    globalCycle = idle;
+    releaseBusIfDone();
+    dataBusBusy.clear();
+    for (CoreState &core : cores) {
+        if (!core.finished) core.readyAt = globalCycle;
+    }
+}
+
+template <typename Address>
+void BasicCacheSimulator<Address>::simulate() {
+    std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+    startIntervals();
+    if (hotBlockCount > 0 && !hotBlocks.isEnabled()) hotBlocks.enable(hotBlockCount, numCores);
+    if (samplePeriod > 0) runSampled();
+    else if (parallel) runParallelLoop();
+    else if (eventDriven) runEventLoop();
+    else runCycleLoop();
+    runSeconds = secondsSince(runStart);
+    tracer.finish();
+    if (!stopped) {
+        // The run ends when the last core retires its last reference
+        globalCycle = 0;
+        for (const CoreState &core : cores) globalCycle = std::max(globalCycle, core.readyAt);
+    }
+    if (intervals.isOpen()) {
+        emitIntervalsUntil(globalCycle);
+        if (globalCycle > intervalStartCycle) emitInterval(globalCycle); // the last, partial interval
+        intervals.finish();
+    }
+}
+
+// Called at the start of every cycle in which something happens. Writes any
+// interval row and takes any checkpoint that is due, and returns false if
+// the run should stop here.
+template <typename Address>
+bool BasicCacheSimulator<Address>::atCycleBoundary() {
+    if (globalCycle < nextCheckpoint && globalCycle < stopCycle && !checkpointSignal &&
+        globalCycle < nextIntervalCycle && completedReferences < nextIntervalReference) {
+        return true;
+    }
+    emitIntervalsUntil(globalCycle);
+    if (completedReferences >= nextIntervalReference) emitInterval(globalCycle);
+    if (globalCycle < nextCheckpoint && globalCycle < stopCycle && !checkpointSignal) return true;
+
+    int signal = checkpointSignal;
+    checkpointSignal = 0;
+    bool stop = globalCycle >= stopCycle || signal == SIGINT || signal == SIGTERM;
+    if (!checkpointFile.empty() && (stop || signal || globalCycle >= nextCheckpoint)) {
+        saveCheckpoint(checkpointFile);
+        while (nextCheckpoint <= globalCycle) nextCheckpoint += checkpointEvery;
+    }
+    if (stop) stopped = true;
+    return !stop;
+}
+
+template <typename Address>
+void BasicCacheSimulator<Address>::runSimulation() {
+    simulate();
+    if (stopped) {
+        std::cout << "Stopped at cycle " << globalCycle;
+        if (!checkpointFile.empty()) std::cout << "; checkpoint written to " << checkpointFile;
+        std::cout << std::endl;
+    }
     printStatistics();
+    if (reportPerformance) printPerformance();
+    if (!summaryFile.empty()) writeSummary(summaryFile);
+}
+
+// A core's totals as of cycle end, at or after every event so far. Idle
+// stretches and bus tenure are booked when they start, so the part that
+// lies at or after end is left out.
+template <typename Address>
+IntervalRow BasicCacheSimulator<Address>::intervalTotals(int coreId, long long end) const {
+    const CoreState &core = cores[coreId];
+    IntervalRow totals;
+    totals.interval = intervalIndex;
+    totals.core = coreId;
+    totals.startCycle = intervalStartCycle;
+    totals.endCycle = end;
+    totals.references = core.totalInstructions;
+    totals.hits = core.hitCount;
+    totals.misses = core.missCount;
+    totals.invalidations = core.busInvalidations;
+    totals.busTraffic = core.dataTraffic;
+    totals.idleCycles = core.idletime - std::max(0LL, core.readyAt - std::max(end, core.idleFrom));
+    totals.busCycles = core.busCycles;
+    for (const std::pair<long long, long long> &window : core.busWindows) {
+        totals.busCycles -= std::max(0LL, window.second - std::max(end, window.first));
+    }
+    return totals;
+}
+
+// Measure the first interval from here: the start of the run or the cycle
+// a checkpoint was restored at
+template <typename Address>
+void BasicCacheSimulator<Address>::startIntervals() {
+    if (!intervals.isOpen()) return;
+    intervalStartCycle = globalCycle;
+    intervalBase.clear();
+    for (int i = 0; i < numCores; i++) intervalBase.push_back(intervalTotals(i, globalCycle));
+    if (intervalCycles > 0) nextIntervalCycle = (globalCycle / intervalCycles + 1) * intervalCycles;
+    if (intervalReferences > 0) nextIntervalReference = completedReferences + intervalReferences;
+}
+
+// Rows for every interval by cycles that ends at or before cycle. Nothing
+// happens between the last event and cycle, so each ends exactly on its
+// multiple of intervalCycles, empty ones included.
+template <typename Address>
+void BasicCacheSimulator<Address>::emitIntervalsUntil(long long cycle) {
+    while (nextIntervalCycle <= cycle) emitInterval(nextIntervalCycle);
+}
+
+// One row per core for [intervalStartCycle, end), then start the next
+// interval at end
+template <typename Address>
+void BasicCacheSimulator<Address>::emitInterval(long long end) {
+    for (int i = 0; i < numCores; i++) {
+        IntervalRow totals = intervalTotals(i, end);
+        const IntervalRow &base = intervalBase[i];
+        IntervalRow row = totals;
+        row.references -= base.references;
+        row.hits -= base.hits;
+        row.misses -= base.misses;
+        row.invalidations -= base.invalidations;
+        row.busTraffic -= base.busTraffic;
+        row.idleCycles -= base.idleCycles;
+        row.busCycles -= base.busCycles;
+        intervals.push(row);
+        intervalBase[i] = totals;
+
+        std::vector<std::pair<long long, long long> > &windows = cores[i].busWindows;
+        windows.erase(std::remove_if(windows.begin(), windows.end(),
+                                     [end](const std::pair<long long, long long>& window) {
+                                         return window.second <= end;
+                                     }),
+                      windows.end());
+    }
+    intervalIndex++;
+    intervalStartCycle = end;
+    if (intervalCycles > 0) nextIntervalCycle = (end / intervalCycles + 1) * intervalCycles;
+    if (intervalReferences > 0) {
+        nextIntervalReference = (completedReferences / intervalReferences + 1) * intervalReferences;
+    }
+}
+
+// The end-of-run statistics as one JSON document. "schema" names the layout
+// and changes whenever a field is renamed or removed.
+template <typename Address>
+void BasicCacheSimulator<Address>::writeSummary(const std::string& path) {
+    std::ofstream out(path.c_str());
+    if (!out.is_open()) throw std::runtime_error("cannot create " + path);
+    out << std::fixed << std::setprecision(4);
+    out << "{\n";
+    out << "  \"schema\": \"l1simulate-summary/1\",\n";
+    out << "  \"trace_prefix\": " << jsonString(tracePrefix) << ",\n";
+    out << "  \"s\": " << setIndexBits << ", \"E\": " << associativity << ", \"b\": " << blockBits
+        << ", \"block_size\": " << blockSize << ", \"sets\": " << numSets << ",\n";
+    out << "  \"replacement\": \"" << replacementName(replacement) << "\", \"bus\": \""
+        << (splitBus ? "split" : "atomic") << "\", \"address_bits\": " << getAddressBits() << ",\n";
+    out << "  \"sampled\": " << (samplePeriod > 0 ? "true" : "false")
+        << ", \"stopped\": " << (stopped ? "true" : "false") << ",\n";
+    out << "  \"cycles\": " << globalCycle << ", \"bus_transactions\": " << totalBusTransactions
+        << ", \"bus_traffic_bytes\": " << totalBusTraffic << ", \"invalidations\": " << totalInvalidations
+        << ",\n";
+    out << "  \"cores\": [\n";
+    for (int i = 0; i < numCores; i++) {
+        const CoreState &core = cores[i];
+        long long references = core.readCount + core.writeCount;
+        out << "    {\"core\": " << i << ", \"instructions\": " << core.totalInstructions
+            << ", \"reads\": " << core.readCount << ", \"writes\": " << core.writeCount
+            << ", \"execution_cycles\": " << core.extime << ", \"idle_cycles\": " << core.idletime
+            << ", \"hits\": " << core.hitCount << ", \"misses\": " << core.missCount
+            << ", \"miss_rate\": " << (references > 0 ? 100.0 * core.missCount / references : 0.0)
+            << ", \"evictions\": " << core.evictionCount << ", \"writebacks\": " << core.writebackCount
+            << ", \"invalidations\": " << core.busInvalidations
+            << ", \"data_traffic_bytes\": " << core.dataTraffic << ", \"bus_cycles\": " << core.busCycles << "}"
+            << (i + 1 < numCores ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+    if (!out) throw std::runtime_error("failed writing " + path);
+}
+
+template <typename Address>
+CoreStatistics BasicCacheSimulator<Address>::getCoreStatistics(int coreId) const {
+    const CoreState &core = cores[coreId];
+    CoreStatistics stats;
+    stats.totalInstructions = core.totalInstructions;
+    stats.readCount = core.readCount;
+    stats.writeCount = core.writeCount;
+    stats.executionCycles = core.extime;
+    stats.idleCycles = core.idletime;
+    stats.missCount = core.missCount;
+    stats.hitCount = core.hitCount;
+    stats.evictionCount = core.evictionCount;
+    stats.writebackCount = core.writebackCount;
+    stats.busInvalidations = core.busInvalidations;
+    stats.dataTraffic = core.dataTraffic;
+    return stats;
 }
 
 //
 // Print simulation statistics according to the requested format
 //
-void CacheSimulator::printStatistics() {
+template <typename Address>
+void BasicCacheSimulator<Address>::printStatistics() {
     std::ofstream outFile;
     if (!outFileName.empty()) {
         outFile.open(outFileName);
@@ -807,7 +1365,7 @@ void CacheSimulator::printStatistics() {
     
     // Print simulation parameters
     out << "Simulation Parameters:" << std::endl;
-    out << "Trace Prefix: " << "app" << std::endl;  // Placeholder, replace with actual prefix
+    out << "Trace Prefix: " << tracePrefix << std::endl;
     out << "Set Index Bits: " << setIndexBits << std::endl;
     out << "Associativity: " << associativity << std::endl;
     out << "Block Bits: " << blockBits << std::endl;
@@ -816,9 +1374,22 @@ void CacheSimulator::printStatistics() {
     out << "Cache Size (KB per core): " << std::fixed << std::setprecision(2) << cacheSize << std::endl;
     out << "MESI Protocol: Enabled" << std::endl;
     out << "Write Policy: Write-back, Write-allocate" << std::endl;
-    out << "Replacement Policy: LRU" << std::endl;
-    out << "Bus: Central snooping bus" << std::endl;
+    out << "Replacement Policy: " << replacementLabel(replacement) << std::endl;
+    if (splitBus) {
+        out << "Bus: Split-transaction snooping bus (" << memorySlotFree.size() << " memory request slots)" << std::endl;
+    } else {
+        out << "Bus: Central snooping bus" << std::endl;
+    }
     out << std::endl;
+
+    // Sampled counters only cover part of the run; report the estimates
+    if (samplePeriod > 0) {
+        printSampleEstimates(out);
+        if (profiler.isEnabled()) printProfile(out);
+        if (hotBlocks.isEnabled()) hotBlocks.print(out, blockBits, getAddressBits());
+        if (outFile.is_open()) outFile.close();
+        return;
+    }
     
     // Core statistics
     for (int i = 0; i < numCores; i++) {
@@ -848,8 +1419,548 @@ void CacheSimulator::printStatistics() {
     out << "Overall Bus Summary:" << std::endl;
     out << "Total Bus Transactions: " << totalBusTransactions << std::endl;
     out << "Total Bus Traffic (Bytes): " << totalBusTraffic << std::endl;
+    if (checkData) {
+        out << "Data Check Mismatches: " << dataMismatches << std::endl;
+    }
+    if (reportBus) {
+        printBusStatistics(out);
+    }
+    if (profiler.isEnabled()) {
+        printProfile(out);
+    }
+    if (hotBlocks.isEnabled()) {
+        hotBlocks.print(out, blockBits, getAddressBits());
+    }
     
     if (outFile.is_open()) {
         outFile.close();
     }
-}
\ No newline at end of file
+}
+// Mean and confidence half-width of one per-reference rate over the units
+struct SampleEstimate {
+    double mean;
+    double halfWidth;
+};
+
+static const double SAMPLE_CONFIDENCE_Z = 3.0; // 99.7%, as in SMARTS
+
+// Each unit's rate is weighted by the references its period covers, so the
+// estimate of a total is the sum over periods of rate times period length.
+static SampleEstimate estimateRate(const std::vector<SampleUnit>& samples, long long SampleUnit::*field) {
+    SampleEstimate estimate = { 0.0, 0.0 };
+    size_t n = samples.size();
+    if (n == 0) return estimate;
+    double weights = 0.0, sum = 0.0;
+    for (const SampleUnit &unit : samples) {
+        weights += unit.periodReferences;
+        sum += unit.periodReferences * ((double)(unit.*field) / unit.references);
+    }
+    estimate.mean = sum / weights;
+    if (n > 1) {
+        double spread = 0.0;
+        for (const SampleUnit &unit : samples) {
+            double deviation = (double)(unit.*field) / unit.references - estimate.mean;
+            double weight = unit.periodReferences / weights;
+            spread += weight * weight * deviation * deviation;
+        }
+        estimate.halfWidth = SAMPLE_CONFIDENCE_Z * std::sqrt(spread * n / (n - 1));
+    }
+    return estimate;
+}
+
+// Whole-run estimates from the sampling units: each statistic's rate per
+// reference times the references in the traces, with a 99.7% interval from
+// the spread of the per-unit rates.
+template <typename Address>
+void BasicCacheSimulator<Address>::printSampleEstimates(std::ostream& out) {
+    long long detailed = 0;
+    for (const SampleUnit &unit : samples) detailed += unit.references;
+    double total = (double)(completedReferences + skippedReferences);
+
+    out << "Sampled Simulation:" << std::endl;
+    out << "Sampling Period (references per core): " << samplePeriod << std::endl;
+    out << "Detailed Warmup (references per core): " << sampleWarmup << std::endl;
+    out << "Measurement Unit (references per core): " << sampleUnit << std::endl;
+    out << "Between Units: " << (sampleFastForward ? "Fast-forward" : "Functional warming") << std::endl;
+    out << "Units Measured: " << samples.size() << std::endl;
+    out << "Total References: " << completedReferences + skippedReferences << std::endl;
+    out << "Measured References: " << detailed << std::endl;
+    if (samples.size() < 30) {
+        out << "Warning: fewer than 30 units; lower the sampling period for trustworthy intervals" << std::endl;
+    }
+    if (sampleFastForward) {
+        // Whether it does depends on the access pattern, not on anything
+        // the units can measure
+        out << "Note: the intervals cover sampling error only; fast-forward can bias cores that share written data"
+            << std::endl;
+    }
+    out << std::endl;
+
+    SampleEstimate misses = estimateRate(samples, &SampleUnit::misses);
+    SampleEstimate idle = estimateRate(samples, &SampleUnit::idleCycles);
+    SampleEstimate traffic = estimateRate(samples, &SampleUnit::busTraffic);
+    SampleEstimate cycles = estimateRate(samples, &SampleUnit::cycles);
+    out << "Estimates (99.7% confidence):" << std::endl;
+    out << std::fixed << std::setprecision(2);
+    out << "Cache Miss Rate: " << 100.0 * misses.mean << "% +/- " << 100.0 * misses.halfWidth << "%" << std::endl;
+    out << std::setprecision(0);
+    out << "Cache Misses: " << misses.mean * total << " +/- " << misses.halfWidth * total << std::endl;
+    out << "Idle Cycles (all cores): " << idle.mean * total << " +/- " << idle.halfWidth * total << std::endl;
+    out << "Bus Traffic (Bytes): " << traffic.mean * total << " +/- " << traffic.halfWidth * total << std::endl;
+    out << "Execution Cycles: " << cycles.mean * total << " +/- " << cycles.halfWidth * total << std::endl;
+    if (checkData) {
+        out << "Data Check Mismatches: " << dataMismatches << std::endl;
+    }
+}
+
+// Per-transaction-type bus occupancy. Queue cycles are the part of the
+// latency spent waiting behind other transactions.
+template <typename Address>
+void BasicCacheSimulator<Address>::printBusStatistics(std::ostream& out) {
+    out << std::endl;
+    out << "Bus Occupancy:" << std::endl;
+    out << std::left << std::setw(27) << "Transaction" << std::right
+        << std::setw(10) << "Count" << std::setw(12) << "Bus Cycles" << std::setw(14) << "Memory Cycles"
+        << std::setw(13) << "Queue Cycles" << std::setw(13) << "Avg Latency" << std::endl;
+    for (int t = 0; t < NUM_BUS_TRANSACTIONS; t++) {
+        const BusTransactionStats &stats = busStats[t];
+        if (stats.count == 0) continue;
+        out << std::left << std::setw(27) << busTransactionName((BusTransaction)t) << std::right
+            << std::setw(10) << stats.count << std::setw(12) << stats.busCycles
+            << std::setw(14) << stats.memoryCycles << std::setw(13) << stats.queueCycles
+            << std::setw(13) << std::fixed << std::setprecision(1)
+            << (double)stats.latencyCycles / stats.count << std::endl;
+    }
+}
+
+// Where the simulator's own time went (--profile): the phase breakdown,
+// then event counts of the simulated run that explain it
+template <typename Address>
+void BasicCacheSimulator<Address>::printProfile(std::ostream& out) {
+    long long executing = 0, idle = 0;
+    for (const CoreState &core : cores) {
+        executing += core.extime;
+        idle += core.idletime;
+    }
+    long long stalled = (long long)profiler.getCounter(PC_STALL_CYCLES);
+
+    out << std::endl;
+    out << "Simulator Profile:" << std::endl;
+    profiler.printPhases(out, runSeconds);
+    out << "Core Steps: " << profiler.getCounter(PC_STEPS) << std::endl;
+    out << "Bus Busy Retries: " << profiler.getCounter(PC_BUS_STALLS) << std::endl;
+    out << "Cycles Executing: " << executing << std::endl;
+    out << "Cycles Stalled for the Bus: " << stalled << std::endl;
+    out << "Cycles Waiting for Misses: " << idle - stalled << std::endl;
+    out << "Snooped Lines: " << profiler.getCounter(PC_SNOOPS) << std::endl;
+    if (parallel) out << "Run-Ahead References: " << profiler.getCounter(PC_RUN_AHEAD) << std::endl;
+    out << "Bus Transactions by Type:" << std::endl;
+    for (int t = 0; t < NUM_BUS_TRANSACTIONS; t++) {
+        if (busStats[t].count == 0) continue;
+        out << "  " << std::left << std::setw(27) << busTransactionName((BusTransaction)t) << std::right
+            << busStats[t].count << std::endl;
+    }
+}
+
+//
+// Simulator cost, as opposed to simulated cost: where the host time and
+// memory went. Printed with --bench.
+//
+template <typename Address>
+void BasicCacheSimulator<Address>::printPerformance() {
+    long long references = 0;
+    for (const CoreState &core : cores) references += core.totalInstructions;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout << std::endl;
+    std::cout << "Simulator Performance:" << std::endl;
+    std::cout << "Construction Time (ms): " << std::fixed << std::setprecision(3) << constructSeconds * 1e3 << std::endl;
+    std::cout << "Simulation Time (ms): " << std::fixed << std::setprecision(3) << runSeconds * 1e3 << std::endl;
+    std::cout << "References Simulated: " << references << std::endl;
+    if (references > 0 && runSeconds > 0) {
+        std::cout << "References per Second: " << std::fixed << std::setprecision(0) << references / runSeconds << std::endl;
+        std::cout << "ns per Reference: " << std::fixed << std::setprecision(2) << runSeconds * 1e9 / references << std::endl;
+    }
+    DecodeStats decode;
+    for (const CoreState &core : cores) {
+        DecodeStats stats = core.trace->getDecodeStats();
+        decode.bytes += stats.bytes;
+        decode.records += stats.records;
+        decode.seconds += stats.seconds;
+        decode.waitSeconds += stats.waitSeconds;
+    }
+    if (decode.bytes > 0) {
+        // Text decoding: summed over cores, so it can exceed the simulation
+        // time when it runs on read-ahead threads
+        std::cout << "Trace Decode Time (ms): " << std::fixed << std::setprecision(3) << decode.seconds * 1e3 << std::endl;
+        if (decode.seconds > 0) {
+            std::cout << "Trace Decode Rate (MB/s): " << std::fixed << std::setprecision(1)
+                      << decode.bytes / decode.seconds / 1e6 << std::endl;
+            std::cout << "Trace Decode Rate (records/s): " << std::fixed << std::setprecision(0)
+                      << decode.records / decode.seconds << std::endl;
+        }
+        std::cout << "Waiting for Decode (ms): " << std::fixed << std::setprecision(3) << decode.waitSeconds * 1e3 << std::endl;
+    }
+    std::cout << "Address Width (bits): " << getAddressBits() << std::endl;
+    std::cout << "Lookup Kernels: " << (cores[0].cache.isSpecialised() ? "Specialised" : "Generic") << std::endl;
+    std::cout << "Tag Compare: " << cores[0].cache.getTagCompare() << std::endl;
+    std::cout << "Tag Store (KB per core): " << std::fixed << std::setprecision(2)
+              << cores[0].cache.footprintBytes() / 1024.0 << std::endl;
+    std::cout << "Peak RSS (KB): " << usage.ru_maxrss << std::endl;
+}
+
+//
+// Checkpoints. The layout follows CheckpointHeader; saveCheckpoint and
+// restoreCheckpoint must visit the fields in the same order.
+//
+static const char CHECKPOINT_MAGIC[4] = { 'L', '1', 'C', 'K' };
+
+template <typename Address>
+static void putVersions(CheckpointWriter& out, const std::unordered_map<Address, uint32_t>& versions) {
+    out.put((uint64_t)versions.size());
+    for (const std::pair<const Address, uint32_t> &entry : versions) {
+        out.put(entry.first);
+        out.put(entry.second);
+    }
+}
+
+template <typename Address>
+static void getVersions(CheckpointReader& in, std::unordered_map<Address, uint32_t>& versions) {
+    uint64_t count;
+    in.get(count);
+    versions.clear();
+    versions.reserve(count);
+    for (uint64_t i = 0; i < count; i++) {
+        Address block;
+        uint32_t version;
+        in.get(block);
+        in.get(version);
+        versions[block] = version;
+    }
+}
+
+template <typename Address>
+void BasicCacheSimulator<Address>::saveCheckpoint(const std::string& path) {
+    CheckpointWriter out(path);
+    CheckpointHeader header;
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.setIndexBits = setIndexBits;
+    header.associativity = associativity;
+    header.blockBits = blockBits;
+    header.numCores = numCores;
+    header.hasData = checkData;
+    header.splitBus = splitBus;
+    header.addressBits = getAddressBits();
+    header.replacement = replacement;
+    out.put(header);
+    out.putString(tracePrefix);
+
+    out.put(globalCycle);
+    out.put(totalInvalidations);
+    out.put(totalBusTraffic);
+    out.put(totalBusTransactions);
+    out.put(busFree);
+    out.put(busNextFree);
+    out.put(busTransaction);
+    out.put(busOwner);
+    out.put(addressBusFree);
+    out.put((uint64_t)memorySlotFree.size());
+    for (long long slot : memorySlotFree) out.put(slot);
+    out.put((uint64_t)dataBusBusy.size());
+    for (const std::pair<const long long, long long> &window : dataBusBusy) {
+        out.put(window.first);
+        out.put(window.second);
+    }
+    out.putBytes(busStats, sizeof(busStats));
+
+    out.put(dataVersion);
+    out.put(dataMismatches);
+    putVersions(out, latestData);
+    putVersions(out, memoryData);
+
+    for (const CoreState &core : cores) {
+        out.put(core.consumed);
+        out.put(core.current.word);
+        out.put(core.hasCurrent);
+        out.put(core.finished);
+        out.put(core.extime);
+        out.put(core.idletime);
+        out.put(core.totalInstructions);
+        out.put(core.readCount);
+        out.put(core.writeCount);
+        out.put(core.missCount);
+        out.put(core.hitCount);
+        out.put(core.evictionCount);
+        out.put(core.writebackCount);
+        out.put(core.busInvalidations);
+        out.put(core.dataTraffic);
+        out.put(core.busCycles);
+        out.put(core.readyAt);
+        out.put(core.missPending);
+        core.cache.saveState(out);
+    }
+    out.commit();
+}
+
+template <typename Address>
+void BasicCacheSimulator<Address>::restoreCheckpoint(const std::string& path, bool resetStats) {
+    CheckpointReader in(path);
+    CheckpointHeader header;
+    in.get(header);
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+        header.version != CHECKPOINT_VERSION) {
+        throw std::runtime_error("not a checkpoint of this simulator version: " + path);
+    }
+    if (header.setIndexBits != setIndexBits || header.associativity != associativity ||
+        header.blockBits != blockBits) {
+        std::ostringstream message;
+        message << "checkpoint was taken with -s " << header.setIndexBits << " -E " << header.associativity
+                << " -b " << header.blockBits;
+        throw std::runtime_error(message.str());
+    }
+    if (header.numCores != numCores) {
+        std::ostringstream message;
+        message << "checkpoint has " << header.numCores << " cores, the traces have " << numCores;
+        throw std::runtime_error(message.str());
+    }
+    if ((int)header.addressBits != getAddressBits()) {
+        std::ostringstream message;
+        message << "checkpoint was taken with --address-bits " << header.addressBits;
+        throw std::runtime_error(message.str());
+    }
+    if (header.replacement != (uint32_t)replacement) {
+        std::string taken = header.replacement < NUM_REPLACEMENT_POLICIES
+                                ? replacementName((ReplacementPolicy)header.replacement) : "?";
+        throw std::runtime_error("checkpoint was taken with --replacement " + taken);
+    }
+    if (checkData && !header.hasData) {
+        throw std::runtime_error("checkpoint was taken without --check-data");
+    }
+    std::string prefix = in.getString();
+    if (tracePrefixOf(prefix) != tracePrefixOf(tracePrefix)) {
+        std::cerr << "Warning: checkpoint was taken on " << prefix << ", continuing on " << tracePrefix << std::endl;
+    }
+
+    in.get(globalCycle);
+    in.get(totalInvalidations);
+    in.get(totalBusTraffic);
+    in.get(totalBusTransactions);
+    in.get(busFree);
+    in.get(busNextFree);
+    in.get(busTransaction);
+    in.get(busOwner);
+    long long savedAddressBusFree;
+    in.get(savedAddressBusFree);
+    uint64_t count;
+    in.get(count);
+    std::vector<long long> savedSlots(count);
+    for (long long &slot : savedSlots) in.get(slot);
+    in.get(count);
+    std::map<long long, long long> savedWindows;
+    for (uint64_t i = 0; i < count; i++) {
+        long long start, end;
+        in.get(start);
+        in.get(end);
+        savedWindows[start] = end;
+    }
+    in.getBytes(busStats, sizeof(busStats));
+
+    // Carry the bus occupancy over if this run uses the other bus model
+    if (splitBus == (bool)header.splitBus) {
+        addressBusFree = savedAddressBusFree;
+        if (splitBus) {
+            // The slot count may differ: keep the busiest slots
+            std::sort(savedSlots.begin(), savedSlots.end(), std::greater<long long>());
+            savedSlots.resize(memorySlotFree.size(), 0);
+            memorySlotFree = savedSlots;
+        }
+        dataBusBusy = savedWindows;
+    } else if (splitBus) {
+        addressBusFree = busFree ? 0 : busNextFree;
+        busFree = true;
+    } else {
+        long long pending = savedAddressBusFree;
+        for (long long slot : savedSlots) pending = std::max(pending, slot);
+        for (const std::pair<const long long, long long> &window : savedWindows) {
+            pending = std::max(pending, window.second);
+        }
+        busFree = pending <= globalCycle;
+        busNextFree = pending;
+    }
+
+    in.get(dataVersion);
+    in.get(dataMismatches);
+    getVersions(in, latestData);
+    getVersions(in, memoryData);
+
+    for (int i = 0; i < numCores; i++) {
+        CoreState &core = cores[i];
+        uint64_t consumed;
+        in.get(consumed);
+        in.get(core.current.word);
+        in.get(core.hasCurrent);
+        in.get(core.finished);
+        in.get(core.extime);
+        in.get(core.idletime);
+        in.get(core.totalInstructions);
+        in.get(core.readCount);
+        in.get(core.writeCount);
+        in.get(core.missCount);
+        in.get(core.hitCount);
+        in.get(core.evictionCount);
+        in.get(core.writebackCount);
+        in.get(core.busInvalidations);
+        in.get(core.dataTraffic);
+        in.get(core.busCycles);
+        in.get(core.readyAt);
+        in.get(core.missPending);
+        core.cache.loadState(in, header.hasData);
+
+        // The reader has handed out its first record already; position it
+        // just past the last record the checkpointed run had taken
+        uint64_t available = core.consumed;
+        if (consumed > available) available += core.trace->skip(consumed - available);
+        if (available < consumed) {
+            std::ostringstream message;
+            message << "trace of core " << i << " is shorter than the checkpoint (" << consumed << " references)";
+            throw std::runtime_error(message.str());
+        }
+        core.consumed = consumed;
+    }
+
+    // Only idle stretches and the atomic bus can still be running at the
+    // checkpoint cycle; a restored split bus's tenure all counts before it
+    for (CoreState &core : cores) {
+        core.idleFrom = globalCycle;
+        core.busWindows.clear();
+    }
+    if (!splitBus && !busFree && busOwner >= 0) bookBusWindow(busOwner, globalCycle, busNextFree - globalCycle);
+
+    rebuildDirectory();
+    if (resetStats) resetStatistics();
+    while (nextCheckpoint <= globalCycle) nextCheckpoint += checkpointEvery;
+}
+
+// The directory is not saved: every valid line of every cache is one sharer
+template <typename Address>
+void BasicCacheSimulator<Address>::rebuildDirectory() {
+    directory = SharerDirectory();
+    directory.setNumCores(numCores);
+    directory.reserve((size_t)numCores * numSets * associativity);
+    for (int i = 0; i < numCores; i++) {
+        Cache<Address> &cache = cores[i].cache;
+        for (int set = 0; set < numSets; set++) {
+            for (int way = 0; way < associativity; way++) {
+                const Line &line = cache.getLine(set, way);
+                if (!line.valid) continue;
+                DirectoryEntry &entry = directory.insert(blockOf(cache.blockAddress(set, line)));
+                directory.addSharer(entry, i);
+                if (line.getState() != SHARED) entry.owner = i;
+            }
+        }
+    }
+}
+
+// Zero every counter but keep the cache, bus and trace state
+template <typename Address>
+void BasicCacheSimulator<Address>::resetStatistics() {
+    for (CoreState &core : cores) {
+        core.extime = 0;
+        core.idletime = 0;
+        core.totalInstructions = 0;
+        core.readCount = 0;
+        core.writeCount = 0;
+        core.missCount = 0;
+        core.hitCount = 0;
+        core.evictionCount = 0;
+        core.writebackCount = 0;
+        core.busInvalidations = 0;
+        core.dataTraffic = 0;
+        core.busCycles = 0;
+        // Time booked before the reset is not counted, however far it runs
+        core.idleFrom = core.readyAt;
+        core.busWindows.clear();
+    }
+    totalInvalidations = 0;
+    totalBusTraffic = 0;
+    totalBusTransactions = 0;
+    dataMismatches = 0;
+    std::memset(busStats, 0, sizeof(busStats));
+}
+
+template class BasicCacheSimulator<uint32_t>;
+template class BasicCacheSimulator<uint64_t>;
+
+//
+// CacheSimulator: picks the narrowest address width the traces fit in, so
+// 32-bit traces keep 8-byte cache lines, and forwards to that simulator.
+// Trace files are only probed at the start; a 32-bit simulator that meets a
+// wider address later stops with an error (see stepCore). Geometries whose
+// index and offset leave no tag bits in 32 need the 64-bit simulator too.
+//
+static const uint64_t ADDRESS_PROBE_RECORDS = 65536;
+
+static int geometryAddressBits(int bits, int s, int b) {
+    if (s > MAX_GEOMETRY_BITS || b > MAX_GEOMETRY_BITS) {
+        throw std::runtime_error("-s and -b must be at most " + std::to_string(MAX_GEOMETRY_BITS));
+    }
+    if (s + b < 32) return bits;
+    if (bits == 32) {
+        throw std::runtime_error("-s plus -b must be below 32 with --address-bits 32");
+    }
+    return 64;
+}
+
+CacheSimulator::CacheSimulator(const std::string& traceFilePrefix, int s, int E, int b,
+                               const std::string& outFileName, bool debug,
+                               const SimulatorOptions& options) {
+    int bits = geometryAddressBits(options.addressBits, s, b);
+    if (bits == ADDRESS_BITS_AUTO) bits = traceAddressBits(traceFilePrefix, options.numCores, ADDRESS_PROBE_RECORDS);
+    if (bits == 64) {
+        impl.reset(new BasicCacheSimulator<uint64_t>(traceFilePrefix, s, E, b, outFileName, debug, options));
+    } else {
+        impl.reset(new BasicCacheSimulator<uint32_t>(traceFilePrefix, s, E, b, outFileName, debug, options));
+    }
+}
+
+CacheSimulator::CacheSimulator(const TraceSet& traces, int s, int E, int b,
+                               const std::string& outFileName, bool debug,
+                               const SimulatorOptions& options) {
+    int bits = geometryAddressBits(options.addressBits, s, b);
+    if (bits == ADDRESS_BITS_AUTO) bits = traces.getAddressBits();
+    if (bits == 64) {
+        impl.reset(new BasicCacheSimulator<uint64_t>(traces, s, E, b, outFileName, debug, options));
+    } else {
+        impl.reset(new BasicCacheSimulator<uint32_t>(traces, s, E, b, outFileName, debug, options));
+    }
+}
+
+CacheSimulator::~CacheSimulator() {}
+
+void CacheSimulator::runSimulation() { impl->runSimulation(); }
+void CacheSimulator::simulate() { impl->simulate(); }
+int CacheSimulator::getNumCores() const { return impl->getNumCores(); }
+CoreStatistics CacheSimulator::getCoreStatistics(int coreId) const { return impl->getCoreStatistics(coreId); }
+long long CacheSimulator::getTotalBusTransactions() const { return impl->getTotalBusTransactions(); }
+long long CacheSimulator::getTotalBusTraffic() const { return impl->getTotalBusTraffic(); }
+long long CacheSimulator::getTotalInvalidations() const { return impl->getTotalInvalidations(); }
+long long CacheSimulator::getGlobalCycle() const { return impl->getGlobalCycle(); }
+double CacheSimulator::getRunSeconds() const { return impl->getRunSeconds(); }
+int CacheSimulator::getAddressBits() const { return impl->getAddressBits(); }
+void CacheSimulator::printStatistics() { impl->printStatistics(); }
+void CacheSimulator::printPerformance() { impl->printPerformance(); }
+void CacheSimulator::saveCheckpoint(const std::string& path) { impl->saveCheckpoint(path); }
+void CacheSimulator::restoreCheckpoint(const std::string& path, bool resetStats) {
+    impl->restoreCheckpoint(path, resetStats);
+}
+bool CacheSimulator::isStopped() const { return impl->isStopped(); }
+void CacheSimulator::printBusStatistics(std::ostream& out) { impl->printBusStatistics(out); }
+void CacheSimulator::printSampleEstimates(std::ostream& out) { impl->printSampleEstimates(out); }
+void CacheSimulator::printProfile(std::ostream& out) { impl->printProfile(out); }
+const std::vector<SampleUnit>& CacheSimulator::getSamples() const { return impl->getSamples(); }
+const BusTransactionStats& CacheSimulator::getBusStatistics(BusTransaction transaction) const {
+    return impl->getBusStatistics(transaction);
+}
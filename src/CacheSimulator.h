@@ -1,11 +1,25 @@
 #ifndef CACHE_SIMULATOR_H
 #define CACHE_SIMULATOR_H
 
+#include "utils.h"
+#include "Directory.h"
+#include "EventTrace.h"
+#include "Profile.h"
+#include "Replacement.h"
 #include <string>
 #include <vector>
 #include <fstream>
 #include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <stdint.h>
+#include <memory>
+#include <chrono>
+#include <climits>
 
+class TraceReader;
+class TraceSet;
 
 enum BusTransaction {
     ReadWithIntentToModify,
@@ -18,35 +32,139 @@ enum BusTransaction {
     None
 };
 
+const int NUM_BUS_TRANSACTIONS = None;
+const char* busTransactionName(BusTransaction transaction);
+
+class CoreWorkers;
+
+// SimulatorOptions::addressBits: pick 32 or 64 from the traces
+const int ADDRESS_BITS_AUTO = 0;
+
+// Largest -s and -b: 1 << s sets and 1 << b byte blocks must fit in an int
+const int MAX_GEOMETRY_BITS = 30;
+
+// Knobs that select how the simulation is carried out rather than what is
+// simulated.
+struct SimulatorOptions {
+    bool eventDriven;  // jump between events instead of ticking every cycle
+    bool checkData;    // carry block contents and verify every read sees the latest write
+    bool reportPerformance; // print construction/run time, throughput and RSS
+    int numCores;      // cores to simulate; 0 = one per _procK trace found
+    bool splitBus;     // split-transaction bus instead of the atomic one
+    int memoryRequests; // split bus: memory requests that may be outstanding at once
+    bool reportBus;    // print per-transaction-type bus occupancy
+    std::string eventFile; // write binary trace events here
+    int traceLevel;    // TRACE_COHERENCE or TRACE_ALL
+    size_t eventRing;  // keep only the last eventRing events (0 = keep all)
+    bool readAhead;    // decode text traces on a producer thread per core
+    std::string checkpointFile; // where checkpoints go (periodic, on signal, at stopAt)
+    long long checkpointEvery; // simulated cycles between checkpoints; 0 = none
+    long long stopAt;  // stop (and checkpoint) at the first cycle boundary >= stopAt; 0 = run to the end
+    int samplePeriod;  // sampled simulation: references per core from one unit to the next; 0 = off
+    int sampleWarmup;  // references per core simulated in detail before each unit
+    int sampleUnit;    // references per core measured in each unit
+    bool sampleFastForward; // skip the references between units instead of warming with them
+    bool parallel;     // one thread per core, synchronised at bus events
+    bool relaxed;      // parallel: also run ahead through shared blocks, up to quantum cycles
+    int quantum;       // parallel relaxed: cycles a core may run past the earliest pending event
+    bool profile;      // count and time the phases of the simulation itself
+    int addressBits;   // 32 or 64; ADDRESS_BITS_AUTO = the narrowest the traces fit in
+    bool genericKernels; // run-time geometry lookup path even where a specialised one exists
+    bool scalarTags;     // compare tags one at a time even where the CPU has SSE or AVX2
+    ReplacementPolicy replacement;
+    long long intervalCycles;     // interval statistics every so many cycles; 0 = off
+    long long intervalReferences; // or every so many references retired by all cores together
+    std::string intervalFile;     // interval rows go here: CSV, or JSON lines for .json/.jsonl
+    std::string summaryFile;      // write a JSON summary of the run here at the end
+    int hotBlocks;                // blocks per event type the hot-block profiler keeps; 0 = off
+
+    SimulatorOptions() : eventDriven(true), checkData(false), reportPerformance(false), numCores(0),
+                         splitBus(false), memoryRequests(4), reportBus(false),
+                         traceLevel(TRACE_ALL), eventRing(0), readAhead(true),
+                         checkpointEvery(0), stopAt(0), samplePeriod(0), sampleWarmup(2000), sampleUnit(1000),
+                         sampleFastForward(false), parallel(false), relaxed(false), quantum(1000),
+                         profile(false), addressBits(ADDRESS_BITS_AUTO), genericKernels(false),
+                         scalarTags(false), replacement(REPLACE_LRU),
+                         intervalCycles(0), intervalReferences(0), hotBlocks(0) {}
+};
+
+// What one sampling unit measured, summed over cores
+struct SampleUnit {
+    long long references;
+    long long misses;
+    long long idleCycles;
+    long long busTraffic;  // bytes
+    long long cycles;      // simulated cycles the unit took
+    long long periodReferences; // references of the whole run this unit stands for
+};
+
+// End-of-run counters of one core
+struct CoreStatistics {
+    long long totalInstructions;
+    long long readCount;
+    long long writeCount;
+    long long executionCycles;
+    long long idleCycles;
+    long long missCount;
+    long long hitCount;
+    long long evictionCount;
+    long long writebackCount;
+    long long busInvalidations;
+    long long dataTraffic; // in bytes
+};
+
+// Bus time taken by one kind of transaction over the run
+struct BusTransactionStats {
+    long long count;
+    long long busCycles;     // address + data bus tenure (atomic bus: the whole tenure)
+    long long memoryCycles;  // cycles a memory request slot was held
+    long long queueCycles;   // waiting behind other transactions for the bus, a slot or data bus
+    long long latencyCycles; // grant to completion, summed
+};
+
+class SimulatorImpl;
+
 class CacheSimulator {
 private:
-    std::vector<struct CoreState> cores; // now holds per-core simulation state
-    std::string outFileName;
-    int numCores;
-    int totalInvalidations;
-    int totalBusTraffic; // in bytes
-    int totalBusTransactions;
-    int globalCycle; //what is this ?
-    bool busFree;
-    unsigned int busNextFree; //bus is next free at this time
-    BusTransaction busTransaction;
-    int busOwner;
-    int blockSize;     // Derived from block bits b: blockSize = 2^b
-    bool debugMode;    // Flag for debug output
-    
-    // Cache configuration
-    int setIndexBits;  // s
-    int associativity; // E
-    int blockBits;     // b
-    int numSets;       // 2^s
+    // The simulator proper, instantiated for 32- or 64-bit addresses
+    std::unique_ptr<SimulatorImpl> impl;
 
 public:
     CacheSimulator(const std::string& traceFilePrefix, int s, int E, int b, 
-                   const std::string& outFileName, bool debug = false);
+                   const std::string& outFileName, bool debug = false,
+                   const SimulatorOptions& options = SimulatorOptions());
+    // Replay traces that are already decoded in memory; traces must outlive
+    // the simulator
+    CacheSimulator(const TraceSet& traces, int s, int E, int b,
+                   const std::string& outFileName, bool debug = false,
+                   const SimulatorOptions& options = SimulatorOptions());
     ~CacheSimulator();
-    void runSimulation();
+    void runSimulation();  // simulate, then print the statistics
+    void simulate();       // run to completion without printing anything
+
+    int getNumCores() const;
+    CoreStatistics getCoreStatistics(int coreId) const;
+    long long getTotalBusTransactions() const;
+    long long getTotalBusTraffic() const;
+    long long getTotalInvalidations() const;
+    long long getGlobalCycle() const;
+    double getRunSeconds() const;
+    int getAddressBits() const;  // 32 or 64
     void printStatistics();
-    void debugPrint(const std::string& message);
+    void printPerformance();
+
+    // Write the complete simulator state to path
+    void saveCheckpoint(const std::string& path);
+    // Continue from a checkpoint taken with the same geometry, core count
+    // and address width. With resetStats, counters restart from zero so
+    // that a run branched off a warmed-up state only reports its own part.
+    void restoreCheckpoint(const std::string& path, bool resetStats = false);
+    bool isStopped() const;
+    void printBusStatistics(std::ostream& out);
+    void printSampleEstimates(std::ostream& out);
+    void printProfile(std::ostream& out);
+    const std::vector<SampleUnit>& getSamples() const;
+    const BusTransactionStats& getBusStatistics(BusTransaction transaction) const;
 };
 
 #endif // CACHE_SIMULATOR_H
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+// Checkpoint file layout (host byte order): CheckpointHeader, then the
+// simulator state written field by field by CacheSimulator::saveCheckpoint.
+// Any change to that sequence must bump CHECKPOINT_VERSION.
+struct CheckpointHeader {
+    char magic[4];        // "L1CK"
+    uint32_t version;     // CHECKPOINT_VERSION
+    int32_t setIndexBits;
+    int32_t associativity;
+    int32_t blockBits;
+    int32_t numCores;
+    uint32_t hasData;     // block contents were tracked (--check-data)
+    uint32_t splitBus;    // bus model the state was taken with
+    uint32_t addressBits; // 32 or 64: width of the saved tags and blocks
+    uint32_t replacement; // ReplacementPolicy of the saved replacement state
+};
+
+const uint32_t CHECKPOINT_VERSION = 5;
+
+// Writes to "<path>.tmp" and renames it over path on commit(), so a run that
+// dies mid-write leaves the previous checkpoint intact.
+class CheckpointWriter {
+private:
+    std::string path;
+    std::ofstream out;
+
+public:
+    explicit CheckpointWriter(const std::string& path)
+        : path(path), out((path + ".tmp").c_str(), std::ios::binary | std::ios::trunc) {
+        if (!out.is_open()) throw std::runtime_error("cannot create checkpoint: " + path);
+    }
+
+    void putBytes(const void* data, size_t size) { out.write(static_cast<const char*>(data), size); }
+    template <typename T> void put(const T& value) { putBytes(&value, sizeof(value)); }
+    void putString(const std::string& value) {
+        put((uint64_t)value.size());
+        putBytes(value.data(), value.size());
+    }
+
+    void commit() {
+        out.close();
+        if (!out || std::rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("failed writing checkpoint: " + path);
+        }
+    }
+};
+
+class CheckpointReader {
+private:
+    std::string path;
+    std::ifstream in;
+
+public:
+    explicit CheckpointReader(const std::string& path) : path(path), in(path.c_str(), std::ios::binary) {
+        if (!in.is_open()) throw std::runtime_error("cannot open checkpoint: " + path);
+    }
+
+    void getBytes(void* data, size_t size) {
+        in.read(static_cast<char*>(data), size);
+        if ((size_t)in.gcount() != size) throw std::runtime_error("truncated checkpoint: " + path);
+    }
+    template <typename T> void get(T& value) { getBytes(&value, sizeof(value)); }
+    void skip(size_t size) { in.seekg(size, std::ios::cur); }
+    std::string getString() {
+        uint64_t size;
+        get(size);
+        std::string value(size, '\0');
+        if (size > 0) getBytes(&value[0], size);
+        return value;
+    }
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,253 @@
+#include "CompressedTrace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const char COMPRESSED_MAGIC[4] = { 'L', '1', 'T', 'Z' };
+static const int MAX_VARINT_BYTES = 10;
+
+static inline uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static inline void putVarint(uint64_t value, std::vector<unsigned char>& out) {
+    while (value >= 0x80) {
+        out.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((unsigned char)value);
+}
+
+// Deltas are taken modulo 2^63, the address space of a record, and
+// sign-extended from bit 62, so zigzag(delta) << 1 fits in 64 bits for any
+// two addresses. The decoder's sum can carry into bit 63, which the shift
+// into the record word drops.
+size_t encodeTraceBlock(const TraceRecord* records, size_t count, std::vector<unsigned char>& out) {
+    size_t start = out.size();
+    uint64_t previous = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t address = records[i].word >> 1;
+        uint64_t delta = zigzag((int64_t)((address - previous) << 1) >> 1);
+        putVarint((delta << 1) | (records[i].word & 1), out);
+        previous = address;
+    }
+    return out.size() - start;
+}
+
+// Turn one varint into the next record
+static inline void emit(uint64_t value, uint64_t& previous, TraceRecord*& out) {
+    previous += (uint64_t)unzigzag(value >> 1);
+    (out++)->word = (previous << 1) | (value & 1);
+}
+
+bool decodeTraceBlock(const unsigned char* payload, size_t bytes, TraceRecord* out, size_t count) {
+    const unsigned char* p = payload;
+    const unsigned char* end = payload + bytes;
+    TraceRecord* outEnd = out + count;
+    uint64_t previous = 0;
+
+#if defined(__SSE2__)
+    // Fast path: one 16-byte load tells where every varint in the window
+    // ends (bytes without the continuation bit). One- and two-byte varints,
+    // by far the most common after delta coding, are assembled straight from
+    // the window; anything longer or straddling the window falls through to
+    // the scalar loop for one value.
+    while (end - p >= 16 && outEnd - out > 16) {
+        __m128i window = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned continuation = (unsigned)_mm_movemask_epi8(window);
+        if (continuation == 0) {
+            for (int i = 0; i < 16; i++) emit(p[i], previous, out);
+            p += 16;
+            continue;
+        }
+        int pos = 0;
+        while (pos < 16) {
+            unsigned rest = continuation >> pos;
+            if (!(rest & 1)) {
+                emit(p[pos], previous, out);
+                pos += 1;
+            } else if (!(rest & 2) && pos + 1 < 16) {
+                emit((uint64_t)(p[pos] & 0x7f) | ((uint64_t)p[pos + 1] << 7), previous, out);
+                pos += 2;
+            } else {
+                break;
+            }
+        }
+        p += pos;
+        if (pos < 16) {
+            // Longer varint: decode it on its own
+            uint64_t value = 0;
+            int shift = 0;
+            for (;;) {
+                if (p == end || shift >= 7 * MAX_VARINT_BYTES) return false;
+                unsigned char byte = *p++;
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) break;
+                shift += 7;
+            }
+            emit(value, previous, out);
+        }
+    }
+#endif
+
+    while (p < end && out < outEnd) {
+        uint64_t value = 0;
+        int shift = 0;
+        for (;;) {
+            if (p == end || shift >= 7 * MAX_VARINT_BYTES) return false;
+            unsigned char byte = *p++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) break;
+            shift += 7;
+        }
+        emit(value, previous, out);
+    }
+    return p == end && out == outEnd;
+}
+
+uint64_t compressTrace(const std::string& inPath, const std::string& outPath, uint32_t coreId,
+                       uint32_t blockRecords) {
+    std::unique_ptr<TraceReader> reader = TraceReader::open(inPath);
+    std::FILE* out = std::fopen(outPath.c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error("cannot create compressed trace: " + outPath);
+    }
+
+    CompressedFileHeader header;
+    std::memcpy(header.magic, COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC));
+    header.version = COMPRESSED_FORMAT_VERSION;
+    header.coreId = coreId;
+    header.blockRecords = blockRecords;
+    header.recordCount = 0;
+    std::fwrite(&header, sizeof(header), 1, out);
+
+    std::vector<TraceRecord> records, decoded;
+    std::vector<unsigned char> payload;
+    records.reserve(blockRecords);
+    bool more = true;
+    while (more) {
+        records.clear();
+        TraceRecord record;
+        while (records.size() < blockRecords && (more = reader->next(record))) records.push_back(record);
+        if (records.empty()) break;
+
+        payload.clear();
+        CompressedBlockHeader block;
+        block.records = (uint32_t)records.size();
+        block.bytes = (uint32_t)encodeTraceBlock(records.data(), records.size(), payload);
+        // Round trip: the block must decode back to exactly what was read
+        decoded.resize(records.size());
+        if (!decodeTraceBlock(payload.data(), payload.size(), decoded.data(), decoded.size()) ||
+            std::memcmp(decoded.data(), records.data(), records.size() * sizeof(TraceRecord)) != 0) {
+            std::fclose(out);
+            throw std::runtime_error("compressed block does not decode back to its records: " + outPath);
+        }
+        std::fwrite(&block, sizeof(block), 1, out);
+        std::fwrite(payload.data(), 1, payload.size(), out);
+        header.recordCount += records.size();
+    }
+
+    // Patch the record count now that it is known
+    std::fseek(out, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, out);
+    if (std::ferror(out) || std::fclose(out) != 0) {
+        throw std::runtime_error("failed writing compressed trace: " + outPath);
+    }
+    return header.recordCount;
+}
+
+//
+// CompressedTraceReader
+//
+CompressedTraceReader::CompressedTraceReader(const std::string& path)
+    : path(path), base(nullptr), length(0), offset(sizeof(CompressedFileHeader)) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open trace file: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CompressedFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("truncated compressed trace: " + path);
+    }
+    length = (size_t)st.st_size;
+    base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        throw std::runtime_error("cannot map trace file: " + path);
+    }
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC)) != 0 ||
+        header.version != COMPRESSED_FORMAT_VERSION || header.blockRecords == 0) {
+        munmap(base, length);
+        base = nullptr;
+        throw std::runtime_error("bad compressed trace header: " + path);
+    }
+    remaining = header.recordCount;
+    buffer.resize(header.blockRecords);
+}
+
+CompressedTraceReader::~CompressedTraceReader() {
+    if (base) munmap(base, length);
+}
+
+bool CompressedTraceReader::refill() {
+    if (remaining == 0) return false;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const unsigned char* data = static_cast<const unsigned char*>(base);
+    CompressedBlockHeader block;
+    if (length - offset < sizeof(block)) {
+        throw std::runtime_error("truncated compressed trace: " + path);
+    }
+    std::memcpy(&block, data + offset, sizeof(block));
+    offset += sizeof(block);
+    if (block.records == 0 || block.records > header.blockRecords || block.records > remaining ||
+        length - offset < block.bytes ||
+        !decodeTraceBlock(data + offset, block.bytes, buffer.data(), block.records)) {
+        throw std::runtime_error("corrupt compressed trace block: " + path);
+    }
+    offset += block.bytes;
+    remaining -= block.records;
+
+    stats.bytes += sizeof(block) + block.bytes;
+    stats.records += block.records;
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cur = buffer.data();
+    end = cur + block.records;
+    return true;
+}
+
+uint64_t CompressedTraceReader::skip(uint64_t count) {
+    uint64_t skipped = std::min(count, (uint64_t)(end - cur));
+    cur += skipped;
+    const unsigned char* data = static_cast<const unsigned char*>(base);
+    while (skipped < count && remaining > 0 && length - offset >= sizeof(CompressedBlockHeader)) {
+        CompressedBlockHeader block;
+        std::memcpy(&block, data + offset, sizeof(block));
+        if (block.records > count - skipped || block.records > remaining ||
+            length - offset - sizeof(block) < block.bytes) {
+            break;
+        }
+        offset += sizeof(block) + block.bytes;
+        remaining -= block.records;
+        skipped += block.records;
+    }
+    return skipped + TraceReader::skip(count - skipped);
+}
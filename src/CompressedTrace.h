@@ -0,0 +1,72 @@
+#ifndef COMPRESSED_TRACE_H
+#define COMPRESSED_TRACE_H
+
+#include "TraceReader.h"
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Compressed trace layout (host byte order):
+//   CompressedFileHeader, then blocks of
+//     CompressedBlockHeader, payload
+// Each reference is one varint of (zigzag(address - previous address) << 1 | op),
+// the difference taken modulo 2^63 so that any 63-bit address fits.
+// previous restarts at 0 in every block, so blocks decode independently
+// and can be skipped using the byte count in their header.
+struct CompressedFileHeader {
+    char magic[4];          // "L1TZ"
+    uint32_t version;       // COMPRESSED_FORMAT_VERSION
+    uint32_t coreId;
+    uint32_t blockRecords;  // records per block (the last one may be short)
+    uint64_t recordCount;
+};
+
+struct CompressedBlockHeader {
+    uint32_t records;
+    uint32_t bytes;         // payload bytes that follow
+};
+
+const uint32_t COMPRESSED_FORMAT_VERSION = 1;
+const uint32_t DEFAULT_BLOCK_RECORDS = 65536;
+
+// Append the encoding of records to out; returns the payload size. Takes
+// any address below TRACE_ADDRESS_LIMIT.
+size_t encodeTraceBlock(const TraceRecord* records, size_t count, std::vector<unsigned char>& out);
+
+// Decode one block payload of count records into out. Returns false if the
+// payload is malformed or does not hold exactly count records.
+bool decodeTraceBlock(const unsigned char* payload, size_t bytes, TraceRecord* out, size_t count);
+
+// Re-encode any readable trace (text, binary or compressed) as a compressed
+// trace. Returns the record count.
+uint64_t compressTrace(const std::string& inPath, const std::string& outPath, uint32_t coreId,
+                       uint32_t blockRecords = DEFAULT_BLOCK_RECORDS);
+
+// Compressed traces, mapped read-only and decoded a block at a time.
+class CompressedTraceReader : public TraceReader {
+private:
+    std::string path;
+    void* base;
+    size_t length;
+    size_t offset;          // next block header
+    CompressedFileHeader header;
+    uint64_t remaining;     // records not decoded yet
+    std::vector<TraceRecord> buffer;
+    DecodeStats stats;
+
+protected:
+    bool refill();
+
+public:
+    explicit CompressedTraceReader(const std::string& path);
+    ~CompressedTraceReader();
+
+    // Whole blocks are skipped by their headers without decoding them
+    uint64_t skip(uint64_t count);
+
+    const CompressedFileHeader& getHeader() const { return header; }
+    DecodeStats getDecodeStats() const { return stats; }
+};
+
+#endif // COMPRESSED_TRACE_H
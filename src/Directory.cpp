@@ -0,0 +1,55 @@
+#include "Directory.h"
+#include <cassert>
+
+void SharerDirectory::setNumCores(int numCores) {
+    assert(entries.empty());
+    words = (numCores + 63) / 64;
+    if (words < 1) words = 1;
+    masks.clear();
+    freeSlots.clear();
+}
+
+void SharerDirectory::reserve(size_t blocks) {
+    entries.reserve(blocks);
+    masks.reserve(blocks * words);
+}
+
+DirectoryEntry& SharerDirectory::insert(uint64_t block) {
+    std::pair<std::unordered_map<uint64_t, DirectoryEntry>::iterator, bool> result =
+        entries.insert(std::make_pair(block, DirectoryEntry()));
+    DirectoryEntry& entry = result.first->second;
+    if (result.second) {
+        if (!freeSlots.empty()) {
+            entry.slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            entry.slot = (uint32_t)(masks.size() / words);
+            masks.resize(masks.size() + words);
+        }
+        entry.owner = -1;
+        entry.sharerCount = 0;
+    }
+    return entry;
+}
+
+void SharerDirectory::removeSharer(uint64_t block, DirectoryEntry& entry, int coreId) {
+    uint64_t& word = maskOf(entry)[coreId >> 6];
+    uint64_t bit = 1ull << (coreId & 63);
+    if (!(word & bit)) return;
+    word &= ~bit;
+    if (entry.owner == coreId) entry.owner = -1;
+    if (--entry.sharerCount == 0) {
+        freeSlots.push_back(entry.slot);
+        entries.erase(block);
+    }
+}
+
+int SharerDirectory::nextSharer(const DirectoryEntry& entry, int from) const {
+    const uint64_t* mask = maskOf(entry);
+    for (int w = from >> 6; w < words; w++) {
+        uint64_t bits = mask[w];
+        if (w == (from >> 6)) bits &= ~0ull << (from & 63);
+        if (bits) return w * 64 + __builtin_ctzll(bits);
+    }
+    return -1;
+}
@@ -0,0 +1,65 @@
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Directory entry of one block that is resident in at least one L1
+struct DirectoryEntry {
+    uint32_t slot;      // index of the sharer mask in SharerDirectory::masks
+    int owner;          // core holding the block EXCLUSIVE or MODIFIED, -1 if only SHARED
+    int sharerCount;
+};
+
+// Global snoop filter: for every block that some L1 holds, which cores hold
+// it. Coherence actions consult it instead of probing every core's cache.
+// Blocks are identified by block number (address >> b). Entries exist only
+// while at least one core holds the block, so the directory never grows past
+// the combined capacity of the caches.
+class SharerDirectory {
+private:
+    int words;                                   // 64-bit words per sharer mask
+    std::unordered_map<uint64_t, DirectoryEntry> entries;
+    std::vector<uint64_t> masks;                 // words per entry, back to back
+    std::vector<uint32_t> freeSlots;
+
+    uint64_t* maskOf(const DirectoryEntry& entry) { return &masks[(size_t)entry.slot * words]; }
+    const uint64_t* maskOf(const DirectoryEntry& entry) const { return &masks[(size_t)entry.slot * words]; }
+
+public:
+    SharerDirectory() : words(1) {}
+
+    // Size masks for numCores cores; only allowed while the directory is empty
+    void setNumCores(int numCores);
+    void reserve(size_t blocks);
+
+    // Entry of block, or nullptr if no cache holds it
+    DirectoryEntry* lookup(uint64_t block) {
+        std::unordered_map<uint64_t, DirectoryEntry>::iterator it = entries.find(block);
+        return it == entries.end() ? nullptr : &it->second;
+    }
+    // Entry of block, created empty if needed
+    DirectoryEntry& insert(uint64_t block);
+    // Drop coreId from block's sharers, erasing the entry once nobody is left
+    void removeSharer(uint64_t block, DirectoryEntry& entry, int coreId);
+
+    void addSharer(DirectoryEntry& entry, int coreId) {
+        uint64_t& word = maskOf(entry)[coreId >> 6];
+        uint64_t bit = 1ull << (coreId & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            entry.sharerCount++;
+        }
+    }
+    bool hasSharer(const DirectoryEntry& entry, int coreId) const {
+        return (maskOf(entry)[coreId >> 6] >> (coreId & 63)) & 1;
+    }
+    // Lowest sharer with id >= from, or -1
+    int nextSharer(const DirectoryEntry& entry, int from) const;
+
+    size_t size() const { return entries.size(); }
+};
+
+#endif // DIRECTORY_H
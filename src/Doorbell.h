@@ -0,0 +1,40 @@
+#ifndef DOORBELL_H
+#define DOORBELL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Lets one side of an SpscRing handoff sleep until the other has done
+// something it waits for: a slot freed, an entry pushed, a stop flag set.
+// The waiter passes the condition it waits for; the other side makes the
+// condition true without the lock, then calls ring(). Use one doorbell per
+// direction.
+class Doorbell {
+private:
+    std::mutex lock;
+    std::condition_variable bell;
+
+public:
+    // Wake the waiter if it is asleep. Taking the lock orders the caller's
+    // update before the waiter's check of its condition, so no wakeup is lost.
+    void ring() {
+        { std::lock_guard<std::mutex> hold(lock); }
+        bell.notify_one();
+    }
+
+    // Return once ready() holds, yielding up to spins times before going to
+    // sleep. ready() may act, e.g. pop the entry it waits for; it runs under
+    // the lock once the waiter sleeps.
+    template <typename Ready>
+    void wait(Ready ready, int spins = 0) {
+        for (int i = 0; i < spins; i++) {
+            if (ready()) return;
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> hold(lock);
+        bell.wait(hold, ready);
+    }
+};
+
+#endif // DOORBELL_H
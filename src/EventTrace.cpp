@@ -0,0 +1,110 @@
+#include "EventTrace.h"
+#include "CacheSimulator.h"
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+static const char EVENT_MAGIC[4] = { 'L', '1', 'E', 'V' };
+
+static const char* eventName(int type) {
+    switch (type) {
+        case TE_ACCESS: return "ACCESS";
+        case TE_HIT: return "HIT";
+        case TE_MISS: return "MISS";
+        case TE_MEMORY_READ: return "MEMORY_READ";
+        case TE_CACHE_TO_CACHE: return "CACHE_TO_CACHE";
+        case TE_EVICT: return "EVICT";
+        case TE_INVALIDATE: return "INVALIDATE";
+        case TE_WRITEBACK: return "WRITEBACK";
+        case TE_BUS_RELEASE: return "BUS_RELEASE";
+        case TE_DATA_MISMATCH: return "DATA_MISMATCH";
+        case TE_CORE_DONE: return "CORE_DONE";
+        default: return "UNKNOWN";
+    }
+}
+
+std::string formatTraceEvent(const TraceEvent& event) {
+    CacheLineState from = (CacheLineState)(event.states >> 4);
+    CacheLineState to = (CacheLineState)(event.states & 0xf);
+
+    std::ostringstream out;
+    out << "[Cycle " << event.cycle << "] Core " << event.core << " " << eventName(event.type);
+    switch (event.type) {
+        case TE_ACCESS:
+        case TE_MISS:
+            out << (event.arg ? " W " : " R ") << addressToString(event.address);
+            break;
+        case TE_HIT:
+            out << " " << addressToString(event.address) << " (" << stateToString(from) << " -> " << stateToString(to) << ")";
+            break;
+        case TE_MEMORY_READ:
+            out << " " << addressToString(event.address) << " (-> " << stateToString(to) << ")";
+            break;
+        case TE_CACHE_TO_CACHE:
+            out << " " << addressToString(event.address) << " from Core " << event.arg
+                << " (" << stateToString(from) << ", -> " << stateToString(to) << ")";
+            break;
+        case TE_EVICT:
+            out << " " << addressToString(event.address) << " (" << stateToString(from) << ")";
+            break;
+        case TE_INVALIDATE:
+            out << " " << addressToString(event.address) << " by Core " << event.arg
+                << " (" << stateToString(from) << " -> I)";
+            break;
+        case TE_WRITEBACK:
+            out << " " << addressToString(event.address) << " " << busTransactionName((BusTransaction)event.arg);
+            break;
+        case TE_DATA_MISMATCH:
+            out << " block " << addressToString(event.address) << " holds version " << event.arg;
+            break;
+        default:
+            break;
+    }
+    return out.str();
+}
+
+EventTracer::EventTracer()
+    : level(TRACE_OFF), count(0), next(0), total(0), keepLast(false), file(nullptr), text(nullptr) {}
+
+EventTracer::~EventTracer() {
+    finish();
+}
+
+void EventTracer::openFile(const std::string& path, size_t ringSize, bool keepLast) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("cannot create event trace: " + path);
+    }
+    EventFileHeader header;
+    std::memcpy(header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC));
+    header.version = EVENT_FORMAT_VERSION;
+    header.eventSize = sizeof(TraceEvent);
+    header.reserved = 0;
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    ring.assign(ringSize > 0 ? ringSize : 1, TraceEvent());
+    count = 0;
+    next = 0;
+    this->keepLast = keepLast;
+}
+
+// Hand the buffered events, oldest first, to the sinks and empty the ring
+void EventTracer::drain() {
+    size_t first = (next + ring.size() - count) % ring.size();
+    for (size_t i = 0; i < count; i++) {
+        const TraceEvent &event = ring[(first + i) % ring.size()];
+        if (file) std::fwrite(&event, sizeof(event), 1, file);
+        if (text) *text << formatTraceEvent(event) << '\n';
+    }
+    count = 0;
+    next = 0;
+}
+
+void EventTracer::finish() {
+    if (count > 0) drain();
+    if (text) text->flush();
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include "utils.h"
+#include <stdint.h>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Highest trace level compiled in. Events above it cost nothing at all;
+// events at or below it cost one compare when tracing is off at run time.
+// Build with "make TRACE_LEVEL=0" to strip tracing completely.
+#ifndef SIM_TRACE_LEVEL
+#define SIM_TRACE_LEVEL 2
+#endif
+
+// Trace levels
+const int TRACE_OFF = 0;
+const int TRACE_COHERENCE = 1; // misses, fills, evictions, invalidations, writebacks
+const int TRACE_ALL = 2;       // also every access, hit and bus release
+
+enum TraceEventType {
+    TE_ACCESS,        // core starts a reference; arg is 0 for R, 1 for W
+    TE_HIT,           // old -> new state of the hit line
+    TE_MISS,          // arg is 0 for R, 1 for W
+    TE_MEMORY_READ,   // fill from memory in the new state
+    TE_CACHE_TO_CACHE,// fill from core arg, which held the block in the old state
+    TE_EVICT,         // victim block and its state
+    TE_INVALIDATE,    // core loses its copy (old state) to a write by core arg
+    TE_WRITEBACK,     // arg is the BusTransaction that carried it
+    TE_BUS_RELEASE,
+    TE_DATA_MISMATCH, // arg is the version the line held
+    TE_CORE_DONE,
+    NUM_TRACE_EVENT_TYPES
+};
+
+// One binary event record
+struct TraceEvent {
+    uint64_t cycle;
+    uint64_t address;
+    uint16_t core;
+    uint8_t type;     // TraceEventType
+    uint8_t states;   // old MESI state << 4 | new MESI state
+    uint32_t arg;     // event specific, see TraceEventType
+};
+
+// Event file layout: EventFileHeader, then TraceEvents back to back.
+struct EventFileHeader {
+    char magic[4];    // "L1EV"
+    uint32_t version; // EVENT_FORMAT_VERSION
+    uint32_t eventSize;
+    uint32_t reserved;
+};
+
+const uint32_t EVENT_FORMAT_VERSION = 2;
+
+// "[Cycle 12] Core 1 EVICT 0x1f40 (M -> I)"
+std::string formatTraceEvent(const TraceEvent& event);
+
+// Records events into a fixed ring of records. Depending on the sinks, a full
+// ring is flushed to a binary file and/or printed as text, or (flight
+// recorder, keepLast) overwritten so that only the latest events survive
+// until finish().
+class EventTracer {
+private:
+    int level;
+    std::vector<TraceEvent> ring;
+    size_t count;         // events in the ring
+    size_t next;          // slot of the next event
+    uint64_t total;
+    bool keepLast;
+    std::FILE* file;
+    std::ostream* text;
+
+    void drain();
+
+public:
+    EventTracer();
+    ~EventTracer();
+
+    // Write every event to path (or, with keepLast, only the last ringSize)
+    void openFile(const std::string& path, size_t ringSize, bool keepLast);
+    // Print events as text as they are drained
+    void printTo(std::ostream& out) { text = &out; }
+    void setLevel(int traceLevel) { level = traceLevel; }
+
+    bool enabled(int eventLevel) const { return eventLevel <= level; }
+
+    void record(uint64_t cycle, int core, TraceEventType type, uint64_t address,
+                CacheLineState from = INVALID, CacheLineState to = INVALID, uint32_t arg = 0) {
+        if (ring.empty()) ring.resize(4096);
+        TraceEvent &event = ring[next];
+        event.cycle = cycle;
+        event.core = (uint16_t)core;
+        event.type = (uint8_t)type;
+        event.states = (uint8_t)((from << 4) | to);
+        event.address = address;
+        event.arg = arg;
+        total++;
+        if (++next == ring.size()) next = 0;
+        if (count < ring.size()) count++;
+        if (count == ring.size() && !keepLast) drain();
+    }
+
+    // Write out whatever is still buffered and close the file
+    void finish();
+    uint64_t getEventCount() const { return total; }
+};
+
+// Record an event if its level is compiled in and enabled. The arguments are
+// not evaluated otherwise.
+#define TRACE_EVENT(tracer, eventLevel, ...) \
+    do { \
+        if ((eventLevel) <= SIM_TRACE_LEVEL && (tracer).enabled(eventLevel)) (tracer).record(__VA_ARGS__); \
+    } while (0)
+
+#endif // EVENT_TRACE_H
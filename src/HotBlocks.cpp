@@ -0,0 +1,237 @@
+#include "HotBlocks.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+const char* hotEventName(HotEvent event) {
+    switch (event) {
+        case HOT_INVALIDATION: return "Invalidations";
+        case HOT_CACHE_TO_CACHE: return "Cache-to-Cache Transfers";
+        case HOT_WRITEBACK_ON_READ: return "WriteBackOnOtherReadMiss";
+        default: return "Unknown";
+    }
+}
+
+// Who the two cores of each event are
+static const char* const HOT_EVENT_ROLES[NUM_HOT_EVENTS] = {
+    "writer -> invalidated", "reader -> supplier", "reader -> supplier"
+};
+
+// Pairs listed per event type
+static const int HOT_PAIRS_SHOWN = 10;
+
+// splitmix64 finaliser, seeded per row so the rows hash independently
+static inline uint64_t mixBlock(uint64_t key, uint64_t seed) {
+    uint64_t z = key + seed * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t coreBit(int core) {
+    return core < 64 ? 1ull << core : 0;
+}
+
+//
+// CountMinSketch
+//
+CountMinSketch::CountMinSketch() : counts((size_t)DEPTH << WIDTH_BITS, 0), total(0) {}
+
+size_t CountMinSketch::column(uint64_t key, int row) {
+    return ((size_t)row << WIDTH_BITS) + (size_t)(mixBlock(key, row + 1) >> (64 - WIDTH_BITS));
+}
+
+void CountMinSketch::add(uint64_t key) {
+    for (int row = 0; row < DEPTH; row++) counts[column(key, row)]++;
+    total++;
+}
+
+uint64_t CountMinSketch::estimate(uint64_t key) const {
+    uint64_t smallest = counts[column(key, 0)];
+    for (int row = 1; row < DEPTH; row++) smallest = std::min(smallest, counts[column(key, row)]);
+    return smallest;
+}
+
+//
+// SpaceSaving
+//
+void SpaceSaving::setCapacity(size_t entries) {
+    capacity = entries;
+    heap.clear();
+    heap.reserve(entries);
+    size_t slots = 1;
+    while (slots < 2 * entries) slots <<= 1;  // at most half full
+    table.assign(slots, -1);
+}
+
+size_t SpaceSaving::slotOf(uint64_t block) const {
+    size_t mask = table.size() - 1;
+    size_t slot = (size_t)mixBlock(block, 0) & mask;
+    while (table[slot] >= 0 && heap[table[slot]].block != block) slot = (slot + 1) & mask;
+    return slot;
+}
+
+// Linear probing without tombstones: pull later entries of the probe run
+// back over the hole whenever that keeps them reachable
+void SpaceSaving::erase(size_t slot) {
+    size_t mask = table.size() - 1;
+    table[slot] = -1;
+    for (size_t next = (slot + 1) & mask; table[next] >= 0; next = (next + 1) & mask) {
+        size_t home = (size_t)mixBlock(heap[table[next]].block, 0) & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            table[slot] = table[next];
+            table[next] = -1;
+            slot = next;
+        }
+    }
+}
+
+void SpaceSaving::siftDown(size_t index) {
+    for (;;) {
+        size_t smallest = index, left = 2 * index + 1, right = left + 1;
+        if (left < heap.size() && heap[left].count < heap[smallest].count) smallest = left;
+        if (right < heap.size() && heap[right].count < heap[smallest].count) smallest = right;
+        if (smallest == index) return;
+        // Find both slots while they still point at the right entries
+        size_t from = slotOf(heap[index].block), to = slotOf(heap[smallest].block);
+        std::swap(heap[index], heap[smallest]);
+        table[from] = (int32_t)smallest;
+        table[to] = (int32_t)index;
+        index = smallest;
+    }
+}
+
+void SpaceSaving::add(uint64_t block, int requester, int other, uint64_t estimate) {
+    size_t slot = slotOf(block);
+    if (table[slot] >= 0) {
+        HotEntry &entry = heap[table[slot]];
+        entry.count++;
+        entry.requesters |= coreBit(requester);
+        entry.others |= coreBit(other);
+        siftDown(table[slot]);
+        return;
+    }
+
+    HotEntry entry = { block, 1, 0, coreBit(requester), coreBit(other) };
+    if (heap.size() < capacity) {
+        // Counts are at least 1, so a new entry at the end keeps heap order
+        table[slot] = (int32_t)heap.size();
+        heap.push_back(entry);
+        return;
+    }
+    // Take over the least frequent entry, but only from a block the sketch
+    // says is seen more often; this one has occurred at least once and at
+    // most estimate times
+    if (estimate <= heap[0].count) return;
+    entry.count = estimate;
+    entry.error = estimate - 1;
+    erase(slotOf(heap[0].block));
+    heap[0] = entry;
+    table[slotOf(block)] = 0;
+    siftDown(0);
+}
+
+std::vector<HotEntry> SpaceSaving::top() const {
+    std::vector<HotEntry> entries(heap);
+    std::sort(entries.begin(), entries.end(), [](const HotEntry& a, const HotEntry& b) {
+        return a.count != b.count ? a.count > b.count : a.block < b.block;
+    });
+    return entries;
+}
+
+size_t SpaceSaving::footprintBytes() const {
+    return heap.capacity() * sizeof(HotEntry) + table.size() * sizeof(int32_t);
+}
+
+//
+// HotBlockProfiler
+//
+void HotBlockProfiler::enable(int blocks, int cores) {
+    enabled = true;
+    numCores = cores;
+    for (int e = 0; e < NUM_HOT_EVENTS; e++) topBlocks[e].setCapacity(blocks);
+    pairs.assign((size_t)NUM_HOT_EVENTS * cores * cores, 0);
+}
+
+void HotBlockProfiler::recordEvent(HotEvent event, uint64_t block, int requester, int other) {
+    sketches[event].add(block);
+    topBlocks[event].add(block, requester, other, sketches[event].estimate(block));
+    pairs[((size_t)event * numCores + requester) * numCores + other]++;
+}
+
+size_t HotBlockProfiler::footprintBytes() const {
+    size_t bytes = pairs.size() * sizeof(uint64_t);
+    for (int e = 0; e < NUM_HOT_EVENTS; e++) {
+        bytes += topBlocks[e].footprintBytes() + sketches[e].footprintBytes();
+    }
+    return bytes;
+}
+
+// "0,2,5" for the cores in mask, "-" for none
+static std::string coreList(uint64_t mask) {
+    if (!mask) return "-";
+    std::ostringstream list;
+    for (int core = 0; core < 64; core++) {
+        if (!((mask >> core) & 1)) continue;
+        if (list.tellp() > 0) list << ",";
+        list << core;
+    }
+    return list.str();
+}
+
+// Per event type: the top blocks, then the core pairs with the most events.
+// Count is an upper bound on a block's events (the smaller of the
+// space-saving count and the sketch estimate), At Least a lower bound.
+void HotBlockProfiler::print(std::ostream& out, int blockBits, int addressBits) const {
+    std::ios_base::fmtflags flags = out.flags();
+    out << std::endl;
+    out << "Hot Blocks (" << std::fixed << std::setprecision(1) << footprintBytes() / 1024.0
+        << " KB profiler memory):" << std::endl;
+    for (int e = 0; e < NUM_HOT_EVENTS; e++) {
+        const CountMinSketch &sketch = sketches[e];
+        out << hotEventName((HotEvent)e) << ": " << sketch.getTotal() << " events" << std::endl;
+        if (sketch.getTotal() == 0) continue;
+
+        out << "  " << std::left << std::setw(addressBits / 4 + 4) << "Block" << std::right
+            << std::setw(10) << "Count" << std::setw(10) << "At Least" << "  "
+            << std::left << std::setw(16) << "Requesters" << "Others" << std::right << std::endl;
+        std::vector<std::pair<uint64_t, HotEntry> > blocks;
+        for (const HotEntry &entry : topBlocks[e].top()) {
+            blocks.push_back(std::make_pair(std::min(entry.count, sketch.estimate(entry.block)), entry));
+        }
+        std::stable_sort(blocks.begin(), blocks.end(),
+                         [](const std::pair<uint64_t, HotEntry>& a, const std::pair<uint64_t, HotEntry>& b) {
+                             return a.first > b.first;
+                         });
+        for (const std::pair<uint64_t, HotEntry> &ranked : blocks) {
+            uint64_t count = ranked.first;
+            const HotEntry &entry = ranked.second;
+            std::ostringstream address;
+            address << "0x" << std::hex << std::setfill('0') << std::setw(addressBits / 4)
+                    << (entry.block << blockBits);
+            out << "  " << std::left << std::setw(addressBits / 4 + 4) << address.str() << std::right
+                << std::setw(10) << count << std::setw(10) << entry.count - entry.error << "  "
+                << std::left << std::setw(16) << coreList(entry.requesters) << coreList(entry.others)
+                << std::right << std::endl;
+        }
+
+        std::vector<std::pair<uint64_t, size_t> > ranked;
+        size_t base = (size_t)e * numCores * numCores;
+        for (size_t i = 0; i < (size_t)numCores * numCores; i++) {
+            if (pairs[base + i] > 0) ranked.push_back(std::make_pair(pairs[base + i], i));
+        }
+        size_t shown = std::min(ranked.size(), (size_t)HOT_PAIRS_SHOWN);
+        std::partial_sort(ranked.begin(), ranked.begin() + shown, ranked.end(),
+                          [](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b) {
+                              return a.first != b.first ? a.first > b.first : a.second < b.second;
+                          });
+        out << "  By core pair (" << HOT_EVENT_ROLES[e] << "):" << std::endl;
+        for (size_t i = 0; i < shown; i++) {
+            out << "    Core " << ranked[i].second / numCores << " -> Core " << ranked[i].second % numCores
+                << ": " << ranked[i].first << " (" << std::fixed << std::setprecision(1)
+                << 100.0 * ranked[i].first / sketch.getTotal() << "%)" << std::endl;
+        }
+    }
+    out.flags(flags);
+}
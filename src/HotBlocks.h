@@ -0,0 +1,109 @@
+#ifndef HOT_BLOCKS_H
+#define HOT_BLOCKS_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Coherence events the hot-block profiler (--hot-blocks) attributes to blocks
+enum HotEvent {
+    HOT_INVALIDATION,       // a copy invalidated by another core's write
+    HOT_CACHE_TO_CACHE,     // a read miss supplied by another core's cache
+    HOT_WRITEBACK_ON_READ,  // WriteBackOnOtherReadMiss: the MODIFIED supplier writes back
+    NUM_HOT_EVENTS
+};
+
+const char* hotEventName(HotEvent event);
+
+// Count-min sketch of per-block event counts. An estimate is never below the
+// true count, and exceeds it by more than e/WIDTH of all events with
+// probability at most e^-DEPTH.
+class CountMinSketch {
+private:
+    static const int DEPTH = 4;
+    static const int WIDTH_BITS = 11;
+
+    std::vector<uint64_t> counts; // DEPTH rows of 2^WIDTH_BITS
+    uint64_t total;
+
+    static size_t column(uint64_t key, int row);
+
+public:
+    CountMinSketch();
+
+    void add(uint64_t key);
+    uint64_t estimate(uint64_t key) const;
+    uint64_t getTotal() const { return total; }
+    size_t footprintBytes() const { return counts.size() * sizeof(uint64_t); }
+};
+
+// One block monitored by SpaceSaving. The block occurred between
+// count - error and count times; the masks hold the cores (below 64) seen on
+// either side of its events since it was last admitted.
+struct HotEntry {
+    uint64_t block;
+    uint64_t count;
+    uint64_t error;
+    uint64_t requesters;  // cores whose access caused the event
+    uint64_t others;      // cores whose copy it acted on
+};
+
+// Space-saving heavy hitters: the capacity most frequent blocks, in fixed
+// memory. A block that is not monitored replaces the one with the smallest
+// count once its sketch estimate is above that count, and starts from the
+// estimate, so counts stay upper bounds without the churn of plain
+// space-saving. Entries form a min-heap on count; an open-addressing table
+// maps blocks to heap positions.
+class SpaceSaving {
+private:
+    std::vector<HotEntry> heap;
+    std::vector<int32_t> table;   // heap index, or -1 for an empty slot
+    size_t capacity;
+
+    size_t slotOf(uint64_t block) const;  // its slot, or the empty one it would take
+    void erase(size_t slot);
+    void siftDown(size_t index);
+
+public:
+    SpaceSaving() : capacity(0) {}
+
+    void setCapacity(size_t entries);
+    // estimate: the block's sketch count, this event included
+    void add(uint64_t block, int requester, int other, uint64_t estimate);
+    // Monitored blocks, highest count first
+    std::vector<HotEntry> top() const;
+    size_t footprintBytes() const;
+};
+
+// Fixed-memory profile of which blocks and which cores cause coherence
+// traffic: per event type, the top blocks by space-saving, a count-min
+// sketch that gates admission and tightens their counts, and exact counts
+// per pair of cores. Memory depends only on --hot-blocks and the core
+// count, never on the trace. Only the simulation thread records.
+class HotBlockProfiler {
+private:
+    bool enabled;
+    int numCores;
+    SpaceSaving topBlocks[NUM_HOT_EVENTS];
+    CountMinSketch sketches[NUM_HOT_EVENTS];
+    std::vector<uint64_t> pairs;   // [event][requester][other]
+
+    void recordEvent(HotEvent event, uint64_t block, int requester, int other);
+
+public:
+    HotBlockProfiler() : enabled(false), numCores(0) {}
+
+    void enable(int blocks, int cores);
+    bool isEnabled() const { return enabled; }
+
+    // block is the block number (address >> b)
+    void record(HotEvent event, uint64_t block, int requester, int other) {
+        if (enabled) recordEvent(event, block, requester, other);
+    }
+
+    void print(std::ostream& out, int blockBits, int addressBits) const;
+    size_t footprintBytes() const;
+};
+
+#endif // HOT_BLOCKS_H
@@ -0,0 +1,75 @@
+#include "IntervalStats.h"
+#include "RunSummary.h"
+#include <iostream>
+#include <stdexcept>
+
+IntervalWriter::IntervalWriter()
+    : file(nullptr), json(false), ring(INTERVAL_RING_ROWS), closing(false) {}
+
+IntervalWriter::~IntervalWriter() {
+    finish();
+}
+
+void IntervalWriter::open(const std::string& outPath) {
+    path = outPath;
+    file = std::fopen(path.c_str(), "w");
+    if (!file) throw std::runtime_error("cannot create " + path);
+    json = isJsonPath(path);
+    if (!json) {
+        std::fputs("interval,core,start_cycle,end_cycle,references,hits,misses,invalidations,"
+                   "bus_traffic_bytes,idle_cycles,bus_cycles,bus_utilisation\n", file);
+    }
+    closing.store(false);
+    writer = std::thread(&IntervalWriter::drain, this);
+}
+
+void IntervalWriter::push(const IntervalRow& row) {
+    if (!ring.push(row)) rowsFree.wait([this, &row] { return ring.push(row); });
+    rowsReady.ring();
+}
+
+// Writer thread. Rows come in bursts of one per core, at most once per
+// simulated interval, so an idle writer sleeps until the next burst.
+void IntervalWriter::drain() {
+    IntervalRow row;
+    for (;;) {
+        // Check closing first: a row pushed before it was set is then
+        // guaranteed to be visible to the pops after it
+        bool finished = closing.load(std::memory_order_acquire);
+        while (ring.pop(row)) writeRow(row);
+        rowsFree.ring();
+        if (finished) return;
+        rowsReady.wait([this] { return closing.load(std::memory_order_acquire) || !ring.isEmpty(); });
+    }
+}
+
+void IntervalWriter::writeRow(const IntervalRow& row) {
+    long long cycles = row.endCycle - row.startCycle;
+    double utilisation = cycles > 0 ? (double)row.busCycles / cycles : 0.0;
+    if (json) {
+        std::fprintf(file,
+                     "{\"interval\": %lld, \"core\": %d, \"start_cycle\": %lld, \"end_cycle\": %lld, "
+                     "\"references\": %lld, \"hits\": %lld, \"misses\": %lld, \"invalidations\": %lld, "
+                     "\"bus_traffic_bytes\": %lld, \"idle_cycles\": %lld, \"bus_cycles\": %lld, "
+                     "\"bus_utilisation\": %.4f}\n",
+                     row.interval, row.core, row.startCycle, row.endCycle, row.references, row.hits,
+                     row.misses, row.invalidations, row.busTraffic, row.idleCycles, row.busCycles,
+                     utilisation);
+    } else {
+        std::fprintf(file, "%lld,%d,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%.4f\n",
+                     row.interval, row.core, row.startCycle, row.endCycle, row.references, row.hits,
+                     row.misses, row.invalidations, row.busTraffic, row.idleCycles, row.busCycles,
+                     utilisation);
+    }
+}
+
+void IntervalWriter::finish() {
+    if (!file) return;
+    closing.store(true, std::memory_order_release);
+    rowsReady.ring();
+    writer.join();
+    bool failed = std::ferror(file) != 0;
+    failed = std::fclose(file) != 0 || failed;
+    file = nullptr;
+    if (failed) std::cerr << "Warning: failed writing interval statistics to " << path << std::endl;
+}
@@ -0,0 +1,65 @@
+#ifndef INTERVAL_STATS_H
+#define INTERVAL_STATS_H
+
+#include "SpscRing.h"
+#include "Doorbell.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// What one core did in one interval of a run (--interval-cycles or
+// --interval-refs). The simulator also keeps one per core as the running
+// totals the next interval is measured from.
+struct IntervalRow {
+    long long interval;      // 0, 1, ... in order
+    int core;
+    long long startCycle;    // the interval covers [startCycle, endCycle)
+    long long endCycle;
+    long long references;
+    long long hits;
+    long long misses;
+    long long invalidations;
+    long long busTraffic;    // bytes
+    long long idleCycles;
+    long long busCycles;     // bus tenure of the core's own transactions
+};
+
+// Streams interval rows to a CSV file, or JSON lines if the path ends in
+// .json or .jsonl. The simulation thread only copies each row into a
+// lock-free ring; a writer thread formats and writes them, so file I/O
+// never runs on the simulation thread. push() only waits when the ring is
+// full, i.e. the writer is INTERVAL_RING_ROWS rows behind. Either side
+// that has to wait sleeps on a Doorbell until the other rings it.
+class IntervalWriter {
+private:
+    static const size_t INTERVAL_RING_ROWS = 4096;
+
+    std::string path;
+    std::FILE* file;
+    bool json;
+    SpscRing<IntervalRow> ring;
+    std::atomic<bool> closing;
+    Doorbell rowsReady; // rows to write, or closing
+    Doorbell rowsFree;  // room in the ring
+    std::thread writer;
+
+    void drain();
+    void writeRow(const IntervalRow& row);
+
+public:
+    IntervalWriter();
+    ~IntervalWriter();
+
+    // Create path, write the CSV header and start the writer thread. Throws
+    // if the file cannot be created.
+    void open(const std::string& path);
+    bool isOpen() const { return file != nullptr; }
+
+    void push(const IntervalRow& row);
+
+    // Write out every row pushed so far and close the file; warns on a write error
+    void finish();
+};
+
+#endif // INTERVAL_STATS_H
@@ -0,0 +1,55 @@
+#include "Profile.h"
+#include <cstring>
+#include <iomanip>
+
+const char* profilePhaseName(ProfilePhase phase) {
+    switch (phase) {
+        case PROFILE_ENGINE: return "Engine (between steps)";
+        case PROFILE_STEP: return "Step dispatch";
+        case PROFILE_TRACE: return "Trace reading";
+        case PROFILE_LOOKUP: return "Cache lookup";
+        case PROFILE_COHERENCE: return "Coherence";
+        case PROFILE_BUS: return "Bus arbitration";
+        case PROFILE_DATA: return "Data checking";
+        case PROFILE_STATS: return "Statistics";
+        default: return "Unknown";
+    }
+}
+
+PhaseProfiler::PhaseProfiler()
+    : enabled(false), timing(false), timingGap(false), countdown(1), random(12345), last(0),
+      readCost(0), depth(0), overflow(0), timedSteps(0) {
+    std::memset(calls, 0, sizeof(calls));
+    std::memset(ticks, 0, sizeof(ticks));
+    std::memset(counters, 0, sizeof(counters));
+    stack[0] = PROFILE_STEP;
+}
+
+// Clock reads are not free (tens of ns where the TSC is virtualised). Their
+// average cost is taken off every timed interval.
+static const int CLOCK_CALIBRATION_READS = 1000;
+
+void PhaseProfiler::enable() {
+    enabled = true;
+    uint64_t first = now(), previous = first;
+    for (int i = 0; i < CLOCK_CALIBRATION_READS; i++) previous = now();
+    readCost = (previous - first) / CLOCK_CALIBRATION_READS;
+}
+
+void PhaseProfiler::printPhases(std::ostream& out, double runSeconds) const {
+    uint64_t total = 0;
+    for (int p = 0; p < NUM_PROFILE_PHASES; p++) total += ticks[p];
+
+    out << "Phase Breakdown (" << timedSteps << " of " << counters[PC_STEPS] << " steps timed):" << std::endl;
+    out << std::left << std::setw(24) << "Phase" << std::right << std::setw(14) << "Calls"
+        << std::setw(12) << "Time (ms)" << std::setw(9) << "Share" << std::setw(10) << "ns/call" << std::endl;
+    for (int p = 0; p < NUM_PROFILE_PHASES; p++) {
+        uint64_t phaseCalls = (p == PROFILE_STEP || p == PROFILE_ENGINE) ? counters[PC_STEPS] : calls[p];
+        if (phaseCalls == 0) continue;
+        double share = total > 0 ? (double)ticks[p] / total : 0;
+        out << std::left << std::setw(24) << profilePhaseName((ProfilePhase)p) << std::right
+            << std::setw(14) << phaseCalls << std::setw(12) << std::fixed << std::setprecision(3)
+            << share * runSeconds * 1e3 << std::setw(8) << std::setprecision(1) << 100.0 * share << "%"
+            << std::setw(10) << std::setprecision(1) << share * runSeconds * 1e9 / phaseCalls << std::endl;
+    }
+}
@@ -0,0 +1,171 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Build with "make PROFILE=0" to compile the --profile hooks out entirely.
+// Compiled in, each hook costs one compare while profiling is off.
+#ifndef SIM_PROFILE
+#define SIM_PROFILE 1
+#endif
+
+// Where a simulation step spends its time. Time not inside any other phase
+// of a step counts as PROFILE_STEP, time from one step to the next as
+// PROFILE_ENGINE.
+enum ProfilePhase {
+    PROFILE_ENGINE,     // between steps: event queue, parallel run-ahead
+    PROFILE_STEP,       // stepCore itself: dispatch, stall bookkeeping
+    PROFILE_TRACE,      // fetching the next reference from the trace reader
+    PROFILE_LOOKUP,     // tag lookup and LRU update in the core's own cache
+    PROFILE_COHERENCE,  // directory and other caches: probes, invalidations, fills, evictions
+    PROFILE_BUS,        // bus arbitration and transaction scheduling
+    PROFILE_DATA,       // --check-data block versions
+    PROFILE_STATS,      // statistics updates when a reference retires
+    NUM_PROFILE_PHASES
+};
+
+enum ProfileCounter {
+    PC_STEPS,           // stepCore calls
+    PC_BUS_STALLS,      // steps that found the bus busy
+    PC_STALL_CYCLES,    // cycles cores waited for the bus
+    PC_SNOOPS,          // lines looked up in other cores' caches
+    PC_RUN_AHEAD,       // references the parallel engine retired off the main thread
+    NUM_PROFILE_COUNTERS
+};
+
+const char* profilePhaseName(ProfilePhase phase);
+
+// Self-profiler for the simulation hot path. Every phase entry and counter
+// is counted; timing is sampled: about one step in PROFILE_SAMPLE_PERIOD is
+// timed phase by phase with the TSC (steady_clock elsewhere), together with
+// the gap up to the next step. The sampled shares are applied to the run's
+// wall time. Phases nest; time goes to the innermost one. Only the
+// simulation thread may use it.
+class PhaseProfiler {
+private:
+    bool enabled;
+    bool timing;             // the current step is being timed
+    bool timingGap;          // timing the engine's work after a timed step
+    uint32_t countdown;      // steps until the next timed one
+    uint32_t random;
+    uint64_t last;           // clock at the last phase change
+    uint64_t readCost;       // ticks one clock read adds to the interval it ends
+    int stack[16];
+    int depth;
+    int overflow;            // phases entered past the top of stack, not timed
+
+    uint64_t calls[NUM_PROFILE_PHASES];
+    uint64_t ticks[NUM_PROFILE_PHASES];    // timed steps only
+    uint64_t counters[NUM_PROFILE_COUNTERS];
+    uint64_t timedSteps;
+
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    void charge() {
+        uint64_t t = now();
+        uint64_t spent = t - last;
+        ticks[stack[depth]] += spent > readCost ? spent - readCost : 0;
+        last = t;
+    }
+
+public:
+    static const uint32_t PROFILE_SAMPLE_PERIOD = 64;
+
+    PhaseProfiler();
+
+    void enable();
+    bool isEnabled() const { return enabled; }
+
+    // Bracket one step; the step is timed if its turn has come
+    void beginStep() {
+        counters[PC_STEPS]++;
+        if (timingGap) {
+            charge();
+            timingGap = false;
+        }
+        if (--countdown > 0) return;
+        // Next timed step in PERIOD/2 .. 3*PERIOD/2 so the sampling does not
+        // lock onto periodic patterns in the traces
+        random = random * 1664525u + 1013904223u;
+        countdown = PROFILE_SAMPLE_PERIOD / 2 + (random >> 26) % PROFILE_SAMPLE_PERIOD + 1;
+        timing = true;
+        depth = 0;
+        overflow = 0;
+        stack[0] = PROFILE_STEP;
+        last = now();
+    }
+    void endStep() {
+        if (!timing) return;
+        charge();
+        timing = false;
+        timedSteps++;
+        timingGap = true;
+        stack[0] = PROFILE_ENGINE;
+        depth = 0;
+        overflow = 0;
+    }
+
+    void enter(ProfilePhase phase) {
+        calls[phase]++;
+        if (!timing) return;
+        if (depth + 1 >= (int)(sizeof(stack) / sizeof(stack[0]))) {
+            // Too deep: the time stays with the enclosing phase
+            overflow++;
+            return;
+        }
+        charge();
+        stack[++depth] = phase;
+    }
+    void leave() {
+        if (!timing) return;
+        if (overflow > 0) {
+            overflow--;
+            return;
+        }
+        if (depth == 0) return;
+        charge();
+        depth--;
+    }
+
+    void count(ProfileCounter counter, uint64_t amount = 1) { counters[counter] += amount; }
+    uint64_t getCounter(ProfileCounter counter) const { return counters[counter]; }
+
+    // Breakdown of runSeconds of simulation by phase
+    void printPhases(std::ostream& out, double runSeconds) const;
+};
+
+// Brackets one step for the scope it lives in
+class ProfileStep {
+private:
+    PhaseProfiler& profiler;
+
+public:
+    explicit ProfileStep(PhaseProfiler& profiler) : profiler(profiler) {
+        if (SIM_PROFILE && profiler.isEnabled()) profiler.beginStep();
+    }
+    ~ProfileStep() {
+        if (SIM_PROFILE && profiler.isEnabled()) profiler.endStep();
+    }
+};
+
+// Profiling hooks; the arguments are not evaluated when profiling is off
+#define PROFILE_ENTER(profiler, phase) \
+    do { if (SIM_PROFILE && (profiler).isEnabled()) (profiler).enter(phase); } while (0)
+#define PROFILE_LEAVE(profiler) \
+    do { if (SIM_PROFILE && (profiler).isEnabled()) (profiler).leave(); } while (0)
+#define PROFILE_COUNT(profiler, counter, amount) \
+    do { if (SIM_PROFILE && (profiler).isEnabled()) (profiler).count(counter, amount); } while (0)
+
+#endif // PROFILE_H
@@ -0,0 +1,41 @@
+#include "Replacement.h"
+
+static const char* const REPLACEMENT_NAMES[NUM_REPLACEMENT_POLICIES] = {
+    "lru", "plru", "srrip", "brrip", "nru", "random"
+};
+
+static const char* const REPLACEMENT_LABELS[NUM_REPLACEMENT_POLICIES] = {
+    "LRU", "Tree-PLRU", "SRRIP", "BRRIP", "NRU", "Random"
+};
+
+const char* replacementName(ReplacementPolicy policy) {
+    return REPLACEMENT_NAMES[policy];
+}
+
+const char* replacementLabel(ReplacementPolicy policy) {
+    return REPLACEMENT_LABELS[policy];
+}
+
+bool parseReplacement(const std::string& name, ReplacementPolicy& policy) {
+    for (int i = 0; i < NUM_REPLACEMENT_POLICIES; i++) {
+        if (name == REPLACEMENT_NAMES[i]) {
+            policy = (ReplacementPolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string replacementCheck(ReplacementPolicy policy, int E) {
+    if (policy == REPLACE_LRU) {
+        if (E >= LruPolicy::NONE) return "LRU supports at most 65534 ways";
+        return "";
+    }
+    if (E > REPLACEMENT_MASK_WAYS) {
+        return std::string(replacementName(policy)) + " supports at most 64 ways";
+    }
+    if (policy == REPLACE_PLRU && (E & (E - 1)) != 0) {
+        return "plru needs a power-of-two associativity";
+    }
+    return "";
+}
@@ -0,0 +1,214 @@
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <stdint.h>
+#include <string>
+
+// Replacement policies. Each one is a struct of static functions over a
+// ReplacementSet, picked at compile time by the cache kernels (see
+// Cache.cpp), so the per-reference path makes no virtual calls. Every
+// operation is O(1) word arithmetic or, for tree-PLRU, O(log E).
+enum ReplacementPolicy {
+    REPLACE_LRU,     // true LRU: recency list per set
+    REPLACE_PLRU,    // tree pseudo-LRU, E-1 bits per set
+    REPLACE_SRRIP,   // static re-reference interval prediction, 2 bits per line
+    REPLACE_BRRIP,   // bimodal RRIP: SRRIP that mostly inserts at distant
+    REPLACE_NRU,     // not recently used, 1 bit per line
+    REPLACE_RANDOM,
+    NUM_REPLACEMENT_POLICIES
+};
+
+// Command-line name ("plru") and the one printed in reports ("Tree-PLRU")
+const char* replacementName(ReplacementPolicy policy);
+const char* replacementLabel(ReplacementPolicy policy);
+// Policy for a --replacement argument; false if there is none by that name
+bool parseReplacement(const std::string& name, ReplacementPolicy& policy);
+// Empty if policy works with E ways, else why not
+std::string replacementCheck(ReplacementPolicy policy, int E);
+
+// Largest associativity of the bit-mask policies (all but LRU)
+const int REPLACEMENT_MASK_WAYS = 64;
+
+// Replacement state of one set. words holds the policy's SET_WORDS words;
+// the mask policies keep the set's valid ways in words[0] so a fill always
+// takes an invalid way first.
+struct ReplacementSet {
+    uint64_t* words;
+    uint16_t* links;   // LRU: previous and next way of each way, 2 per way
+    uint32_t* random;  // the cache's random number state
+    int ways;
+
+    uint64_t allWays() const { return ways >= 64 ? ~0ull : (1ull << ways) - 1; }
+};
+
+// Next number of the cache's xorshift generator
+inline uint32_t replacementRandom(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// words[0]: head (most recently used) in the low half, tail in the high
+// half. Invalidated ways move to the tail, so the invalid ways of a set are
+// always the ones the list would evict first.
+struct LruPolicy {
+    static const int SET_WORDS = 1;
+    static const uint16_t NONE = 0xffff;
+
+    static int head(const ReplacementSet& set) { return (int)(uint32_t)set.words[0]; }
+    static int tail(const ReplacementSet& set) { return (int)(set.words[0] >> 32); }
+    static void setEnds(ReplacementSet& set, uint32_t head, uint32_t tail) {
+        set.words[0] = head | (uint64_t)tail << 32;
+    }
+
+    static void unlink(ReplacementSet& set, int way) {
+        uint16_t prev = set.links[2 * way], next = set.links[2 * way + 1];
+        uint32_t first = head(set), last = tail(set);
+        if (prev != NONE) set.links[2 * prev + 1] = next; else first = next;
+        if (next != NONE) set.links[2 * next] = prev; else last = prev;
+        setEnds(set, first, last);
+    }
+
+    // Cold sets evict way 0 first, then way 1, and so on
+    static void init(ReplacementSet& set) {
+        for (int way = 0; way < set.ways; way++) {
+            set.links[2 * way] = way + 1 < set.ways ? way + 1 : NONE;
+            set.links[2 * way + 1] = way > 0 ? way - 1 : NONE;
+        }
+        setEnds(set, set.ways - 1, 0);
+    }
+    static void touch(ReplacementSet& set, int way) {
+        if (head(set) == way) return;
+        unlink(set, way);
+        uint32_t first = head(set);
+        set.links[2 * way] = NONE;
+        set.links[2 * way + 1] = (uint16_t)first;
+        set.links[2 * first] = (uint16_t)way;
+        setEnds(set, way, tail(set));
+    }
+    static void insert(ReplacementSet& set, int way) { touch(set, way); }
+    static void invalidate(ReplacementSet& set, int way) {
+        if (tail(set) == way) return;
+        unlink(set, way);
+        uint32_t last = tail(set);
+        set.links[2 * way] = (uint16_t)last;
+        set.links[2 * way + 1] = NONE;
+        set.links[2 * last + 1] = (uint16_t)way;
+        setEnds(set, head(set), way);
+    }
+    static int victim(ReplacementSet& set) { return tail(set); }
+};
+
+// Shared by the mask policies: words[0] is the valid mask
+struct MaskPolicy {
+    static void init(ReplacementSet& set) { set.words[0] = 0; }
+    static void invalidate(ReplacementSet& set, int way) { set.words[0] &= ~(1ull << way); }
+    // Lowest invalid way, or -1 when the set is full
+    static int invalidWay(const ReplacementSet& set) {
+        uint64_t invalid = ~set.words[0] & set.allWays();
+        return invalid ? __builtin_ctzll(invalid) : -1;
+    }
+};
+
+// words[1]: the E-1 tree nodes, heap order from bit 1; a node's bit says
+// which half holds the next victim. E must be a power of two.
+struct PlruPolicy : MaskPolicy {
+    static const int SET_WORDS = 2;
+
+    static void init(ReplacementSet& set) { set.words[0] = set.words[1] = 0; }
+    // Point every node on the path to way away from it
+    static void touch(ReplacementSet& set, int way) {
+        uint64_t tree = set.words[1];
+        unsigned int node = (unsigned int)(set.ways + way);
+        while (node > 1) {
+            unsigned int parent = node >> 1;
+            if (node & 1) tree &= ~(1ull << parent); else tree |= 1ull << parent;
+            node = parent;
+        }
+        set.words[1] = tree;
+    }
+    static void insert(ReplacementSet& set, int way) {
+        set.words[0] |= 1ull << way;
+        touch(set, way);
+    }
+    static int victim(ReplacementSet& set) {
+        int way = invalidWay(set);
+        if (way >= 0) return way;
+        unsigned int node = 1;
+        while (node < (unsigned int)set.ways) node = 2 * node + ((set.words[1] >> node) & 1);
+        return (int)node - set.ways;
+    }
+};
+
+// words[1]: referenced bits. When the last clear bit would be set, all the
+// others are cleared instead.
+struct NruPolicy : MaskPolicy {
+    static const int SET_WORDS = 2;
+
+    static void init(ReplacementSet& set) { set.words[0] = set.words[1] = 0; }
+    static void touch(ReplacementSet& set, int way) {
+        uint64_t referenced = set.words[1] | 1ull << way;
+        if ((referenced & set.allWays()) == set.allWays()) referenced = 1ull << way;
+        set.words[1] = referenced;
+    }
+    static void insert(ReplacementSet& set, int way) {
+        set.words[0] |= 1ull << way;
+        touch(set, way);
+    }
+    static int victim(ReplacementSet& set) {
+        int way = invalidWay(set);
+        if (way >= 0) return way;
+        return __builtin_ctzll(~set.words[1] & set.allWays());
+    }
+};
+
+// 2-bit re-reference prediction values as two bit planes: words[1] the low
+// bits, words[2] the high bits. Hits predict near (0), fills long (2), and
+// the victim is a distant (3) way, after aging the whole set until one is.
+// Bimodal inserts most fills at distant too, one in BRRIP_LONG_ONE_IN long.
+template <bool Bimodal>
+struct RripPolicy : MaskPolicy {
+    static const int SET_WORDS = 3;
+    static const uint32_t BRRIP_LONG_ONE_IN = 32;
+
+    static void init(ReplacementSet& set) { set.words[0] = set.words[1] = set.words[2] = 0; }
+    static void setValue(ReplacementSet& set, int way, unsigned int value) {
+        uint64_t bit = 1ull << way;
+        set.words[1] = (set.words[1] & ~bit) | (value & 1 ? bit : 0);
+        set.words[2] = (set.words[2] & ~bit) | (value & 2 ? bit : 0);
+    }
+    static void touch(ReplacementSet& set, int way) { setValue(set, way, 0); }
+    static void insert(ReplacementSet& set, int way) {
+        set.words[0] |= 1ull << way;
+        bool distant = Bimodal && replacementRandom(set.random) % BRRIP_LONG_ONE_IN != 0;
+        setValue(set, way, distant ? 3 : 2);
+    }
+    static int victim(ReplacementSet& set) {
+        int way = invalidWay(set);
+        if (way >= 0) return way;
+        uint64_t all = set.allWays();
+        for (;;) {
+            uint64_t low = set.words[1] & all, high = set.words[2] & all;
+            if (low & high) return __builtin_ctzll(low & high);
+            // No way is at 3, so incrementing every value cannot overflow
+            set.words[2] = high ^ low;
+            set.words[1] = ~low & all;
+        }
+    }
+};
+
+struct RandomPolicy : MaskPolicy {
+    static const int SET_WORDS = 1;
+
+    static void touch(ReplacementSet&, int) {}
+    static void insert(ReplacementSet& set, int way) { set.words[0] |= 1ull << way; }
+    static int victim(ReplacementSet& set) {
+        int way = invalidWay(set);
+        if (way >= 0) return way;
+        return (int)(replacementRandom(set.random) % (uint32_t)set.ways);
+    }
+};
+
+#endif // REPLACEMENT_H
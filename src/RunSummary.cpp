@@ -0,0 +1,73 @@
+#include "RunSummary.h"
+#include <sstream>
+#include <iomanip>
+
+RunSummary::RunSummary(const CacheSimulator& sim, int s, int E, int b)
+    : s(s), E(E), b(b), instructions(0), reads(0), writes(0), misses(0), evictions(0),
+      writebacks(0), invalidations(0), idleCycles(0),
+      busTransactions(sim.getTotalBusTransactions()), busTraffic(sim.getTotalBusTraffic()),
+      cycles(sim.getGlobalCycle()), seconds(sim.getRunSeconds()) {
+    for (int i = 0; i < sim.getNumCores(); i++) {
+        CoreStatistics core = sim.getCoreStatistics(i);
+        instructions += core.totalInstructions;
+        reads += core.readCount;
+        writes += core.writeCount;
+        misses += core.missCount;
+        evictions += core.evictionCount;
+        writebacks += core.writebackCount;
+        invalidations += core.busInvalidations;
+        idleCycles += core.idleCycles;
+    }
+}
+
+std::string RunSummary::csvHeader() {
+    return "s,E,b,cache_kb,instructions,reads,writes,misses,miss_rate,evictions,"
+           "writebacks,invalidations,bus_transactions,bus_traffic_bytes,idle_cycles,"
+           "cycles,sim_seconds";
+}
+
+std::string RunSummary::csvRow() const {
+    std::ostringstream row;
+    row << s << ',' << E << ',' << b << ','
+        << std::fixed << std::setprecision(2) << cacheKB() << ','
+        << instructions << ',' << reads << ',' << writes << ','
+        << misses << ',' << std::setprecision(4) << missRate() << ','
+        << evictions << ',' << writebacks << ',' << invalidations << ','
+        << busTransactions << ',' << busTraffic << ','
+        << idleCycles << ',' << cycles << ','
+        << std::setprecision(6) << seconds;
+    return row.str();
+}
+
+std::string RunSummary::jsonFields() const {
+    std::ostringstream fields;
+    fields << "\"s\": " << s << ", \"E\": " << E << ", \"b\": " << b
+           << ", \"cache_kb\": " << std::fixed << std::setprecision(2) << cacheKB()
+           << ", \"instructions\": " << instructions << ", \"reads\": " << reads
+           << ", \"writes\": " << writes << ", \"misses\": " << misses
+           << ", \"miss_rate\": " << std::setprecision(4) << missRate()
+           << ", \"evictions\": " << evictions << ", \"writebacks\": " << writebacks
+           << ", \"invalidations\": " << invalidations
+           << ", \"bus_transactions\": " << busTransactions
+           << ", \"bus_traffic_bytes\": " << busTraffic
+           << ", \"idle_cycles\": " << idleCycles << ", \"cycles\": " << cycles
+           << ", \"sim_seconds\": " << std::setprecision(6) << seconds;
+    return fields.str();
+}
+
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '"' || text[i] == '\\') quoted += '\\';
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool isJsonPath(const std::string& path) {
+    return endsWith(path, ".json") || endsWith(path, ".jsonl");
+}
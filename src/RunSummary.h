@@ -0,0 +1,40 @@
+#ifndef RUN_SUMMARY_H
+#define RUN_SUMMARY_H
+
+#include "CacheSimulator.h"
+#include <string>
+
+// Whole-run totals of one simulation, summed over cores, as written by the
+// sweep and batch modes
+struct RunSummary {
+    int s, E, b;
+    long long instructions;
+    long long reads;
+    long long writes;
+    long long misses;
+    long long evictions;
+    long long writebacks;
+    long long invalidations;
+    long long idleCycles;
+    long long busTransactions;
+    long long busTraffic;
+    long long cycles;      // cycle at which the last core finished
+    double seconds;        // host time spent simulating
+
+    RunSummary(const CacheSimulator& sim, int s, int E, int b);
+
+    double missRate() const { return instructions > 0 ? 100.0 * misses / instructions : 0.0; }
+    double cacheKB() const { return (double)(1 << s) * E * (1 << b) / 1024.0; }
+
+    static std::string csvHeader();
+    std::string csvRow() const;
+    // Comma-separated "key": value pairs, without the enclosing braces
+    std::string jsonFields() const;
+};
+
+// text as a quoted JSON string
+std::string jsonString(const std::string& text);
+// Whether an output file takes JSON (lines): it ends in .json or .jsonl
+bool isJsonPath(const std::string& path);
+
+#endif // RUN_SUMMARY_H
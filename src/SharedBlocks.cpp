@@ -0,0 +1,38 @@
+#include "SharedBlocks.h"
+
+// splitmix64 finaliser, seeded per hash so the slots are independent
+static inline uint64_t mixBlock(uint64_t key, uint64_t seed) {
+    uint64_t z = key + seed * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void SharedBlockFilter::reset(int slotBits) {
+    mask = ((size_t)1 << slotBits) - 1;
+    slots.reset(new std::atomic<int32_t>[mask + 1]);
+    for (size_t i = 0; i <= mask; i++) slots[i].store(EMPTY, std::memory_order_relaxed);
+}
+
+size_t SharedBlockFilter::slotOf(uint64_t block, int hash) const {
+    return (size_t)mixBlock(block, hash + 1) & mask;
+}
+
+// A slot only moves from EMPTY to a core and from a core to SHARED_SLOT
+void SharedBlockFilter::add(uint64_t block, int coreId) {
+    for (int hash = 0; hash < HASHES; hash++) {
+        std::atomic<int32_t> &slot = slots[slotOf(block, hash)];
+        int32_t seen = slot.load(std::memory_order_relaxed);
+        while (seen != SHARED_SLOT && seen != coreId &&
+               !slot.compare_exchange_weak(seen, seen == EMPTY ? coreId : SHARED_SLOT,
+                                           std::memory_order_relaxed)) {
+        }
+    }
+}
+
+bool SharedBlockFilter::isShared(uint64_t block) const {
+    for (int hash = 0; hash < HASHES; hash++) {
+        if (slots[slotOf(block, hash)].load(std::memory_order_relaxed) != SHARED_SLOT) return false;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef SHARED_BLOCKS_H
+#define SHARED_BLOCKS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// The blocks more than one core's trace references, for the strict parallel
+// engine, in fixed memory. Each block maps to HASHES slots; a slot holds the
+// one core that has touched it, or says that several have. A block is
+// shared when all its slots are. A block two cores reference always is; a
+// private block only looks shared when other cores' blocks land on every one
+// of its slots, which only costs run-ahead, never accuracy.
+class SharedBlockFilter {
+private:
+    static const int HASHES = 2;
+    static const int32_t EMPTY = -1;
+    static const int32_t SHARED_SLOT = -2;
+
+    std::unique_ptr<std::atomic<int32_t>[]> slots;
+    size_t mask;
+
+    size_t slotOf(uint64_t block, int hash) const;
+
+public:
+    SharedBlockFilter() : mask(0) {}
+
+    // Drop any blocks added so far and allocate 2^slotBits slots
+    void reset(int slotBits);
+    // Safe to call from several threads at once
+    void add(uint64_t block, int coreId);
+    bool isShared(uint64_t block) const;
+    size_t footprintBytes() const { return slots ? (mask + 1) * sizeof(int32_t) : 0; }
+};
+
+#endif // SHARED_BLOCKS_H
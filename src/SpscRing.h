@@ -0,0 +1,54 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free ring for exactly one producer thread and one consumer thread.
+// head is only written by the consumer and tail only by the producer; each
+// publishes its index with a release store that the other side acquires.
+// Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+private:
+    std::vector<T> slots;
+    size_t mask;
+    // Padding keeps the two indices on separate cache lines
+    char padBefore[64];
+    std::atomic<size_t> head; // next slot to pop
+    char padBetween[64];
+    std::atomic<size_t> tail; // next slot to push
+    char padAfter[64];
+
+public:
+    explicit SpscRing(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    bool push(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size()) return false;
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Nothing to pop; exact on the consumer side, a snapshot elsewhere
+    bool isEmpty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    bool pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        value = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,138 @@
+#include "StackDistance.h"
+#include "TraceReader.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+
+static const uint64_t NO_BLOCK = ~(uint64_t)0;
+static const uint32_t INITIAL_SET_CAPACITY = 64;
+
+StackDistanceAnalyzer::StackDistanceAnalyzer(int s, int b, int maxAssociativity)
+    : blockBits(b), numSets(1 << s), maxAssociativity(maxAssociativity),
+      sets(numSets), histogram(maxAssociativity + 1, 0), coldMisses(0), references(0) {}
+
+uint32_t StackDistanceAnalyzer::prefixSum(const std::vector<uint32_t>& tree, uint32_t i) {
+    uint32_t sum = 0;
+    for (; i > 0; i -= i & (~i + 1)) sum += tree[i];
+    return sum;
+}
+
+void StackDistanceAnalyzer::add(std::vector<uint32_t>& tree, uint32_t i, int delta) {
+    for (; i < tree.size(); i += i & (~i + 1)) tree[i] += delta;
+}
+
+// Out of time slots: renumber the live blocks 1..live in access order, and
+// double the capacity if they would still fill more than half of it. Keeps
+// memory proportional to the blocks a set has seen, not to trace length.
+void StackDistanceAnalyzer::compact(SetState& set) {
+    uint32_t capacity = set.tree.empty() ? 0 : (uint32_t)set.tree.size() - 1;
+    uint32_t newCapacity = INITIAL_SET_CAPACITY;
+    while (newCapacity < 2 * set.live) newCapacity *= 2;
+    if (newCapacity < capacity) newCapacity = capacity;
+
+    std::vector<uint64_t> blockAt(newCapacity + 1, NO_BLOCK);
+    uint32_t t = 1;
+    for (uint32_t old = 1; old <= capacity; old++) {
+        if (set.blockAt[old] == NO_BLOCK) continue;
+        blockAt[t] = set.blockAt[old];
+        lastTime[blockAt[t]] = t;
+        t++;
+    }
+
+    // Fenwick node i covers (i - lowbit(i), i]; times 1..live are all marked
+    std::vector<uint32_t> tree(newCapacity + 1, 0);
+    for (uint32_t i = 1; i <= newCapacity; i++) {
+        uint32_t low = i - (i & (~i + 1));
+        if (set.live > low) tree[i] = std::min(i, set.live) - low;
+    }
+
+    set.tree.swap(tree);
+    set.blockAt.swap(blockAt);
+    set.now = set.live + 1;
+}
+
+void StackDistanceAnalyzer::access(uint64_t address) {
+    uint64_t block = address >> blockBits;
+    SetState& set = sets[block & (numSets - 1)];
+    references++;
+
+    if (set.now >= set.tree.size()) compact(set);
+    uint32_t t = set.now++;
+
+    std::unordered_map<uint64_t, uint32_t>::iterator it = lastTime.find(block);
+    if (it == lastTime.end()) {
+        coldMisses++;
+        lastTime.insert(std::make_pair(block, t));
+        set.live++;
+    } else {
+        uint32_t previous = it->second;
+        uint32_t distance = prefixSum(set.tree, t - 1) - prefixSum(set.tree, previous);
+        histogram[std::min<uint32_t>(distance, maxAssociativity)]++;
+        add(set.tree, previous, -1);
+        set.blockAt[previous] = NO_BLOCK;
+        it->second = t;
+    }
+    add(set.tree, t, +1);
+    set.blockAt[t] = block;
+}
+
+uint64_t StackDistanceAnalyzer::getMisses(int E) const {
+    uint64_t misses = coldMisses;
+    for (int d = E; d <= maxAssociativity; d++) misses += histogram[d];
+    return misses;
+}
+
+void runStackDistanceAnalysis(const std::string& prefix, int s, const std::vector<int>& bValues,
+                              int maxAssociativity, int numCores, const std::string& csvFileName) {
+    if (numCores <= 0) numCores = findCoreCount(prefix);
+    if (numCores <= 0) throw std::runtime_error("no traces found for " + prefix);
+
+    // One analyzer per (core, block size); each trace is read exactly once
+    std::vector<std::vector<StackDistanceAnalyzer> > analyzers(numCores);
+    for (int core = 0; core < numCores; core++) {
+        for (size_t k = 0; k < bValues.size(); k++) {
+            analyzers[core].push_back(StackDistanceAnalyzer(s, bValues[k], maxAssociativity));
+        }
+        std::unique_ptr<TraceReader> reader = TraceReader::openCore(prefix, core, true);
+        TraceRecord record;
+        while (reader->next(record)) {
+            for (size_t k = 0; k < bValues.size(); k++) {
+                analyzers[core][k].access(record.address());
+            }
+        }
+    }
+
+    std::ofstream outFile;
+    if (!csvFileName.empty()) {
+        outFile.open(csvFileName);
+        if (!outFile.is_open()) throw std::runtime_error("cannot create " + csvFileName);
+    }
+    std::ostream &out = (outFile.is_open() ? outFile : std::cout);
+
+    out << "s,b,E,core,references,misses,miss_rate" << std::endl;
+    for (size_t k = 0; k < bValues.size(); k++) {
+        for (int E = 1; E <= maxAssociativity; E++) {
+            uint64_t totalReferences = 0, totalMisses = 0;
+            for (int core = 0; core <= numCores; core++) {
+                uint64_t references, misses;
+                if (core < numCores) {
+                    references = analyzers[core][k].getReferences();
+                    misses = analyzers[core][k].getMisses(E);
+                    totalReferences += references;
+                    totalMisses += misses;
+                } else {
+                    references = totalReferences;
+                    misses = totalMisses;
+                }
+                double missRate = references > 0 ? 100.0 * misses / references : 0.0;
+                out << s << ',' << bValues[k] << ',' << E << ',';
+                if (core < numCores) out << core;
+                else out << "all";
+                out << ',' << references << ',' << misses << ','
+                    << std::fixed << std::setprecision(4) << missRate << std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Single-pass LRU stack-distance profile of one reference stream for a fixed
+// number of sets and block size. For every reference it records how many
+// distinct blocks of the same set were touched since the previous reference
+// to its block; an E-way LRU cache hits exactly when that distance is below
+// E, so one pass yields the miss count of every associativity at once.
+//
+// Distances are counted with a Fenwick tree over per-set access times in
+// which only the latest access of each block is marked, so each reference
+// costs O(log n) rather than a scan of the LRU stack.
+class StackDistanceAnalyzer {
+private:
+    struct SetState {
+        uint32_t now;                   // next access time (1-based)
+        uint32_t live;                  // marked times == resident blocks
+        std::vector<uint32_t> tree;     // Fenwick tree over times 1..capacity
+        std::vector<uint64_t> blockAt;  // block accessed at each marked time
+
+        SetState() : now(1), live(0) {}
+    };
+
+    int blockBits;
+    int numSets;
+    int maxAssociativity;
+    std::vector<SetState> sets;
+    std::unordered_map<uint64_t, uint32_t> lastTime; // block -> set-local time
+    std::vector<uint64_t> histogram; // [d] for d < max, [max] for d >= max
+    uint64_t coldMisses;
+    uint64_t references;
+
+    static uint32_t prefixSum(const std::vector<uint32_t>& tree, uint32_t i);
+    static void add(std::vector<uint32_t>& tree, uint32_t i, int delta);
+    void compact(SetState& set);
+
+public:
+    StackDistanceAnalyzer(int s, int b, int maxAssociativity);
+
+    void access(uint64_t address);
+
+    uint64_t getReferences() const { return references; }
+    // LRU misses of an E-way cache with this geometry, 1 <= E <= max
+    uint64_t getMisses(int E) const;
+};
+
+// Profile the per-core traces of prefix (numCores of them, or all that exist
+// if numCores is 0) in one pass and write the miss-rate curve
+// for E = 1..maxAssociativity, per core and summed over cores, for each block
+// size in bValues. Coherence traffic is not modelled: these are the misses
+// of private LRU caches.
+void runStackDistanceAnalysis(const std::string& prefix, int s, const std::vector<int>& bValues,
+                              int maxAssociativity, int numCores, const std::string& csvFileName);
+
+#endif // STACK_DISTANCE_H
@@ -0,0 +1,103 @@
+#include "Sweep.h"
+#include "TraceReader.h"
+#include "RunSummary.h"
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib>
+
+bool isSweepList(const std::string& spec) {
+    return spec.find_first_of(",-") != std::string::npos;
+}
+
+static int parseSweepValue(const std::string& text, const std::string& spec) {
+    char* endPtr;
+    long value = std::strtol(text.c_str(), &endPtr, 10);
+    if (text.empty() || *endPtr != '\0' || value <= 0) {
+        throw std::invalid_argument("bad value list: " + spec);
+    }
+    return (int)value;
+}
+
+std::vector<int> parseSweepList(const std::string& spec) {
+    std::vector<int> values;
+    std::istringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t dash = item.find('-');
+        if (dash == std::string::npos) {
+            values.push_back(parseSweepValue(item, spec));
+            continue;
+        }
+        int lo = parseSweepValue(item.substr(0, dash), spec);
+        int hi = parseSweepValue(item.substr(dash + 1), spec);
+        if (hi < lo) throw std::invalid_argument("bad value list: " + spec);
+        for (int v = lo; v <= hi; v++) values.push_back(v);
+    }
+    if (values.empty()) throw std::invalid_argument("bad value list: " + spec);
+    return values;
+}
+
+void runSweep(const std::string& prefix, const std::vector<int>& sValues,
+              const std::vector<int>& EValues, const std::vector<int>& bValues,
+              const std::string& csvFileName, int jobs, const SimulatorOptions& options) {
+    std::vector<SweepPoint> points;
+    for (size_t i = 0; i < sValues.size(); i++)
+        for (size_t j = 0; j < EValues.size(); j++)
+            for (size_t k = 0; k < bValues.size(); k++) {
+                SweepPoint p = { sValues[i], EValues[j], bValues[k] };
+                points.push_back(p);
+            }
+
+    // Decode the traces once; every worker replays the same records
+    TraceSet traces(prefix, options.numCores);
+    std::cerr << "Sweeping " << points.size() << " configurations over "
+              << traces.getReferenceCount() << " references on " << traces.getNumCores() << " cores with " << jobs << " threads" << std::endl;
+
+    // Workers pull configurations off a shared counter. Rows are kept by
+    // index so the CSV comes out in sweep order whatever finishes first.
+    std::vector<std::string> rows(points.size());
+    std::vector<std::string> errors(points.size());
+    std::atomic<size_t> nextPoint(0);
+    SimulatorOptions runOptions = options;
+    runOptions.reportPerformance = false;
+
+    auto worker = [&]() {
+        for (size_t i = nextPoint++; i < points.size(); i = nextPoint++) {
+            const SweepPoint& p = points[i];
+            try {
+                CacheSimulator sim(traces, p.s, p.E, p.b, "", false, runOptions);
+                sim.simulate();
+                rows[i] = RunSummary(sim, p.s, p.E, p.b).csvRow();
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < jobs; t++) threads.push_back(std::thread(worker));
+    worker();
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+    std::ofstream outFile;
+    if (!csvFileName.empty()) {
+        outFile.open(csvFileName);
+        if (!outFile.is_open()) throw std::runtime_error("cannot create " + csvFileName);
+    }
+    std::ostream &out = (outFile.is_open() ? outFile : std::cout);
+
+    out << RunSummary::csvHeader() << std::endl;
+    for (size_t i = 0; i < points.size(); i++) {
+        if (!errors[i].empty()) {
+            std::cerr << "Error: s=" << points[i].s << " E=" << points[i].E << " b=" << points[i].b
+                      << ": " << errors[i] << std::endl;
+            continue;
+        }
+        out << rows[i] << std::endl;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "CacheSimulator.h"
+#include <string>
+#include <vector>
+
+// One cache geometry of a parameter sweep
+struct SweepPoint {
+    int s;
+    int E;
+    int b;
+};
+
+// True if a -s/-E/-b argument names more than one value ("4,6,8", "4-8")
+bool isSweepList(const std::string& spec);
+
+// Expand "4", "4,6,8", "4-8" or any comma-separated mix of values and
+// inclusive ranges. Throws std::invalid_argument on malformed input.
+std::vector<int> parseSweepList(const std::string& spec);
+
+// Simulate every (s, E, b) combination of the three lists against the traces
+// of prefix, decoded once and shared by jobs worker threads. Writes one CSV
+// row per configuration to csvFileName (stdout if empty).
+void runSweep(const std::string& prefix, const std::vector<int>& sValues,
+              const std::vector<int>& EValues, const std::vector<int>& bValues,
+              const std::string& csvFileName, int jobs, const SimulatorOptions& options);
+
+#endif // SWEEP_H
@@ -0,0 +1,161 @@
+#include "SyntheticTrace.h"
+#include <algorithm>
+#include <stdexcept>
+
+static const char* const PATTERN_NAMES[PATTERN_COUNT] = {
+    "stream", "random", "producer-consumer", "migratory", "true-sharing", "false-sharing", "read-mostly"
+};
+
+// Layout: shared structures from SHARED_BASE up, then one private region
+// per core, everything below 4 GB
+static const uint64_t SHARED_BASE = 0x01000000ull;
+static const uint64_t REGION_ALIGN = 4096;
+static const uint64_t ADDRESS_LIMIT = 1ull << 32;
+
+TracePattern patternFromName(const std::string& name) {
+    for (int p = 0; p < PATTERN_COUNT; p++) {
+        if (name == PATTERN_NAMES[p]) return (TracePattern)p;
+    }
+    return PATTERN_COUNT;
+}
+
+const char* patternName(TracePattern pattern) {
+    return pattern < PATTERN_COUNT ? PATTERN_NAMES[pattern] : "unknown";
+}
+
+static inline uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// splitmix64: one multiply-xorshift round per number, plenty for traces
+static inline uint64_t nextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, n) for n < 2^32 without a division
+static inline uint32_t below(uint64_t random, uint32_t n) {
+    return (uint32_t)(((random >> 32) * n) >> 32);
+}
+
+// Write decisions use the low half of the number, below() the high half
+static inline MemoryOperation writeIf(uint64_t random, uint64_t threshold) {
+    return ((random << 32) | (random >> 32)) < threshold ? WRITE : READ;
+}
+
+static inline uint64_t probabilityThreshold(double p) {
+    if (p <= 0) return 0;
+    if (p >= 1) return UINT64_MAX;
+    return (uint64_t)(p * 18446744073709551616.0);
+}
+
+SyntheticTrace::SyntheticTrace(const SyntheticTraceOptions& options) : options(options) {
+    if (options.numCores <= 0 || options.mix.empty() || options.footprint < 4 || options.stride == 0 ||
+        options.phase == 0 || options.blockSize < 4 || (options.blockSize & (options.blockSize - 1)) != 0) {
+        throw std::runtime_error("invalid synthetic trace options");
+    }
+
+    double total = 0;
+    for (size_t i = 0; i < options.mix.size(); i++) {
+        if (options.mix[i].second < 0) throw std::runtime_error("negative pattern weight");
+        total += options.mix[i].second;
+    }
+    if (total <= 0) throw std::runtime_error("pattern weights add up to zero");
+    double sum = 0;
+    for (size_t i = 0; i < options.mix.size(); i++) {
+        sum += options.mix[i].second;
+        cumulative.push_back(i + 1 == options.mix.size() ? UINT64_MAX : probabilityThreshold(sum / total));
+    }
+    writeThreshold = probabilityThreshold(options.writeRatio);
+    tableWriteThreshold = probabilityThreshold(options.tableWriteRatio);
+
+    if (options.footprint / 4 >= ADDRESS_LIMIT) throw std::runtime_error("footprint too large");
+    footprintWords = (uint32_t)(options.footprint / 4);
+    blockWords = options.blockSize / 4;
+    objects = (uint32_t)options.numCores;
+
+    uint64_t regionSize = alignUp(options.footprint, REGION_ALIGN);
+    sharedBase = SHARED_BASE;
+    bufferBase = sharedBase + regionSize;
+    objectBase = bufferBase + regionSize * options.numCores;
+    trueBlock = alignUp(objectBase + (uint64_t)objects * options.blockSize, REGION_ALIGN);
+    falseBlock = trueBlock + options.blockSize;
+    privateBase = alignUp(falseBlock + options.blockSize, REGION_ALIGN);
+    privateSpan = regionSize;
+    if (privateBase + privateSpan * options.numCores > ADDRESS_LIMIT) {
+        throw std::runtime_error("synthetic trace layout does not fit in 32-bit addresses; reduce the footprint or core count");
+    }
+}
+
+size_t SyntheticTrace::generate(int core, uint64_t chunk, TraceRecord* out) const {
+    uint64_t first = chunk * SYNTHETIC_CHUNK_RECORDS;
+    if (first >= options.refsPerCore) return 0;
+    size_t count = (size_t)std::min<uint64_t>(SYNTHETIC_CHUNK_RECORDS, options.refsPerCore - first);
+
+    uint64_t state = options.seed;
+    state = nextRandom(state) ^ ((uint64_t)core << 40) ^ chunk;
+    uint64_t privateRegion = privateBase + privateSpan * core;
+    uint64_t ownBuffer = bufferBase + privateSpan * core;
+    uint64_t sourceBuffer = bufferBase + privateSpan * ((core + options.numCores - 1) % options.numCores);
+    uint32_t lag = (uint32_t)(options.phase % footprintWords);
+    bool single = cumulative.size() == 1;
+
+    for (size_t n = 0; n < count; n++) {
+        uint64_t i = first + n;
+        uint64_t random = nextRandom(state);
+        TracePattern pattern = options.mix[0].first;
+        if (!single) {
+            size_t k = 0;
+            while (random > cumulative[k]) k++;
+            pattern = options.mix[k].first;
+            random = nextRandom(state);
+        }
+
+        MemoryOperation op = READ;
+        uint64_t address;
+        switch (pattern) {
+        case PATTERN_STREAM:
+            address = privateRegion + (i * options.stride) % options.footprint;
+            op = writeIf(random, writeThreshold);
+            break;
+        case PATTERN_RANDOM:
+            address = privateRegion + (uint64_t)below(random, footprintWords) * 4;
+            op = writeIf(random, writeThreshold);
+            break;
+        case PATTERN_PRODUCER_CONSUMER:
+            // Even references fill this core's buffer; odd ones read the
+            // previous core's buffer a phase behind its producer
+            if ((i & 1) == 0) {
+                address = ownBuffer + (uint64_t)((i / 2) % footprintWords) * 4;
+                op = WRITE;
+            } else {
+                address = sourceBuffer + (uint64_t)(((i / 2) + footprintWords - lag) % footprintWords) * 4;
+            }
+            break;
+        case PATTERN_MIGRATORY:
+            // Each turn a core takes over the object its neighbour held in
+            // the previous one and reads then writes its words
+            address = objectBase + (uint64_t)((i / options.phase + core) % objects) * options.blockSize +
+                      (uint64_t)((i / 2) % blockWords) * 4;
+            if (i & 1) op = WRITE;
+            break;
+        case PATTERN_TRUE_SHARING:
+            address = trueBlock + (uint64_t)below(random, blockWords) * 4;
+            op = writeIf(random, writeThreshold);
+            break;
+        case PATTERN_FALSE_SHARING:
+            address = falseBlock + (uint64_t)(core % blockWords) * 4;
+            op = writeIf(random, writeThreshold);
+            break;
+        case PATTERN_READ_MOSTLY:
+        default:
+            address = sharedBase + (uint64_t)below(random, footprintWords) * 4;
+            op = writeIf(random, tableWriteThreshold);
+            break;
+        }
+        out[n] = TraceRecord::make(op, address);
+    }
+    return count;
+}
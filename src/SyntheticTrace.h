@@ -0,0 +1,72 @@
+#ifndef SYNTHETIC_TRACE_H
+#define SYNTHETIC_TRACE_H
+
+#include "TraceReader.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Access patterns of generated traces. Each one drives a different path
+// through the coherence protocol.
+enum TracePattern {
+    PATTERN_STREAM,             // strided sweep over a private footprint
+    PATTERN_RANDOM,             // uniform over a private footprint
+    PATTERN_PRODUCER_CONSUMER,  // write own buffer, read the previous core's a phase later
+    PATTERN_MIGRATORY,          // read-modify-write of objects handed from core to core
+    PATTERN_TRUE_SHARING,       // every core reads and writes the words of one block
+    PATTERN_FALSE_SHARING,      // every core writes its own word of one block
+    PATTERN_READ_MOSTLY,        // shared table, rarely written
+    PATTERN_COUNT
+};
+
+// "stream" -> PATTERN_STREAM; PATTERN_COUNT if the name is unknown
+TracePattern patternFromName(const std::string& name);
+const char* patternName(TracePattern pattern);
+
+struct SyntheticTraceOptions {
+    int numCores;
+    uint64_t refsPerCore;
+    std::vector<std::pair<TracePattern, double> > mix;  // pattern and relative weight
+    uint64_t footprint;         // bytes per private region, buffer or shared table
+    uint32_t stride;            // stream stride in bytes
+    uint32_t blockSize;         // block the sharing patterns are laid out for
+    uint64_t phase;             // references per producer/consumer phase and migratory turn
+    double writeRatio;          // stream, random and true/false sharing
+    double tableWriteRatio;     // read-mostly table
+    uint64_t seed;
+
+    SyntheticTraceOptions()
+        : numCores(4), refsPerCore(1000000), footprint(1 << 20), stride(4), blockSize(64),
+          phase(1024), writeRatio(0.3), tableWriteRatio(0.01), seed(1) {}
+};
+
+// Records are produced in chunks of SYNTHETIC_CHUNK_RECORDS. A chunk depends
+// only on the options, the core and the chunk index, so chunks can be
+// generated in any order on any number of threads and the trace comes out
+// the same.
+const uint64_t SYNTHETIC_CHUNK_RECORDS = 1 << 16;
+
+class SyntheticTrace {
+private:
+    SyntheticTraceOptions options;
+    std::vector<uint64_t> cumulative;   // mix weights scaled to 2^64, running sum
+    uint64_t writeThreshold, tableWriteThreshold;
+    uint32_t footprintWords, blockWords;
+    uint32_t objects;                   // migratory objects, one block each
+    uint64_t sharedBase, bufferBase, objectBase, trueBlock, falseBlock;
+    uint64_t privateBase, privateSpan;
+
+public:
+    // Throws std::runtime_error if the options are inconsistent or the
+    // layout does not fit in 32-bit addresses
+    explicit SyntheticTrace(const SyntheticTraceOptions& options);
+
+    const SyntheticTraceOptions& getOptions() const { return options; }
+    uint64_t chunksPerCore() const {
+        return (options.refsPerCore + SYNTHETIC_CHUNK_RECORDS - 1) / SYNTHETIC_CHUNK_RECORDS;
+    }
+    // Fill out with chunk chunk of core's trace; returns the record count
+    size_t generate(int core, uint64_t chunk, TraceRecord* out) const;
+};
+
+#endif // SYNTHETIC_TRACE_H
@@ -0,0 +1,474 @@
+#include "TraceReader.h"
+#include "CompressedTrace.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <iostream>
+#include <chrono>
+
+static const char TRACE_MAGIC[4] = { 'L', '1', 'T', 'B' };
+static const size_t TEXT_CHUNK_RECORDS = 4096;
+static const size_t TEXT_BLOCK_BYTES = 1 << 20;      // text read per read() call
+static const size_t READ_AHEAD_BATCHES = 8;
+static const size_t READ_AHEAD_BATCH_RECORDS = 16384;
+static const int READ_AHEAD_SPINS = 64;              // yields before a read-ahead side sleeps
+
+static bool fileExists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20; // lower case
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+enum LineResult { LINE_SKIPPED, LINE_PARSED, LINE_TOO_WIDE };
+
+// Parse the line [p, end), which holds no newline
+static inline LineResult parseLine(const char* p, const char* end, TraceRecord& record) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p == end) return LINE_SKIPPED;
+    MemoryOperation op;
+    if (*p == 'R' || *p == 'r') op = READ;
+    else if (*p == 'W' || *p == 'w') op = WRITE;
+    else return LINE_SKIPPED;
+    p++;
+
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (end - p >= 2 && p[0] == '0' && (p[1] | 0x20) == 'x') p += 2;
+    const char* digits = p;
+    uint64_t address = 0;
+    bool tooWide = false;
+    for (; p < end; p++) {
+        int digit = hexDigit(*p);
+        if (digit < 0) break;
+        // Any digit shifted in once the top nibble is in use would be lost
+        if (address >> 59) tooWide = true;
+        address = (address << 4) | (uint64_t)digit;
+    }
+    if (p == digits) return LINE_SKIPPED;
+    if (tooWide || address >= TRACE_ADDRESS_LIMIT) return LINE_TOO_WIDE;
+    record = TraceRecord::make(op, address);
+    return LINE_PARSED;
+}
+
+bool parseTraceLine(const char* line, TraceRecord& record) {
+    LineResult result = parseLine(line, line + std::strlen(line), record);
+    if (result == LINE_TOO_WIDE) throw std::runtime_error("trace address wider than 63 bits");
+    return result == LINE_PARSED;
+}
+
+size_t parseTraceText(const char* text, size_t length, bool atEnd,
+                      TraceRecord* out, size_t capacity, size_t& produced,
+                      const std::string& path, uint64_t& line) {
+    const char* p = text;
+    const char* end = text + length;
+    produced = 0;
+    while (produced < capacity && p < end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!newline && !atEnd) break;
+        const char* lineEnd = newline ? newline : end;
+        line++;
+        LineResult result = parseLine(p, lineEnd, out[produced]);
+        if (result == LINE_PARSED) produced++;
+        else if (result == LINE_TOO_WIDE) {
+            throw std::runtime_error(path + ":" + std::to_string(line) +
+                                     ": address wider than 63 bits (trace addresses are 63-bit)");
+        }
+        p = newline ? newline + 1 : end;
+    }
+    return p - text;
+}
+
+// Move the undecoded tail of text to the front and read more after it,
+// growing text if a single line fills it. Returns false at end of file.
+static bool readText(int fd, std::vector<char>& text, size_t& begin, size_t& end, const std::string& path) {
+    std::memmove(text.data(), text.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+    if (end == text.size()) text.resize(text.size() * 2);
+    ssize_t n = ::read(fd, text.data() + end, text.size() - end);
+    if (n < 0) {
+        throw std::runtime_error("error reading trace file: " + path);
+    }
+    end += n;
+    return n > 0;
+}
+
+static double nanosSince(std::chrono::steady_clock::time_point start) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+std::string resolveTracePath(const std::string& prefix, int coreId) {
+    std::string base = prefix + "_proc" + std::to_string(coreId);
+    if (fileExists(base + ".bin")) return base + ".bin";
+    if (fileExists(base + ".ctr")) return base + ".ctr";
+    return base + ".trace";
+}
+
+std::string tracePrefixOf(const std::string& path, int* coreId) {
+    size_t slash = path.rfind('/');
+    size_t pos = path.rfind("_proc");
+    if (pos == std::string::npos || (slash != std::string::npos && pos < slash)) return "";
+    size_t digits = pos + 5;
+    size_t end = digits;
+    while (end < path.size() && path[end] >= '0' && path[end] <= '9') end++;
+    if (end == digits) return "";
+    std::string ext = path.substr(end);
+    if (ext != ".trace" && ext != ".bin" && ext != ".ctr") return "";
+    if (coreId) *coreId = std::atoi(path.c_str() + digits);
+    return path.substr(0, pos);
+}
+
+int findCoreCount(const std::string& prefix) {
+    size_t slash = prefix.rfind('/');
+    std::string dirName = (slash == std::string::npos) ? "" : prefix.substr(0, slash + 1);
+
+    DIR* dir = opendir(dirName.empty() ? "." : dirName.c_str());
+    if (!dir) return 0;
+    int count = 0;
+    for (struct dirent* entry = readdir(dir); entry; entry = readdir(dir)) {
+        int coreId;
+        if (tracePrefixOf(dirName + entry->d_name, &coreId) == prefix) {
+            count = std::max(count, coreId + 1);
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+// An address needs 64 bits if anything is set above bit 32 of its word
+static const uint64_t WIDE_ADDRESS_BITS = ~((1ull << 33) - 1);
+
+int addressBitsOf(const std::vector<TraceRecord>& records) {
+    uint64_t any = 0;
+    for (size_t i = 0; i < records.size(); i++) any |= records[i].word;
+    return (any & WIDE_ADDRESS_BITS) ? 64 : 32;
+}
+
+int traceAddressBits(const std::string& prefix, int numCores, uint64_t maxRecords) {
+    if (numCores <= 0) numCores = findCoreCount(prefix);
+    for (int i = 0; i < numCores; i++) {
+        std::string path = resolveTracePath(prefix, i);
+        if (!fileExists(path)) continue;
+        std::unique_ptr<TraceReader> reader = TraceReader::open(path);
+        TraceRecord record;
+        uint64_t any = 0;
+        for (uint64_t n = 0; n < maxRecords && reader->next(record); n++) any |= record.word;
+        if (any & WIDE_ADDRESS_BITS) return 64;
+    }
+    return 32;
+}
+
+std::unique_ptr<TraceReader> TraceReader::openCore(const std::string& prefix, int coreId, bool readAhead) {
+    static const std::vector<TraceRecord> noRecords;
+    std::string path = resolveTracePath(prefix, coreId);
+    if (!fileExists(path)) {
+        std::cerr << "Warning: no trace for core " << coreId << " (" << path << "), core stays idle" << std::endl;
+        return std::unique_ptr<TraceReader>(new MemoryTraceReader(noRecords));
+    }
+    return open(path, readAhead);
+}
+
+uint64_t TraceReader::skip(uint64_t count) {
+    uint64_t skipped = 0;
+    while (skipped < count) {
+        if (cur == end && !refill()) break;
+        uint64_t n = std::min(count - skipped, (uint64_t)(end - cur));
+        cur += n;
+        skipped += n;
+    }
+    return skipped;
+}
+
+std::unique_ptr<TraceReader> TraceReader::open(const std::string& path, bool readAhead) {
+    char magic[4] = { 0, 0, 0, 0 };
+    std::ifstream probe(path.c_str(), std::ios::binary);
+    if (!probe.is_open()) {
+        throw std::runtime_error("cannot open trace file: " + path);
+    }
+    probe.read(magic, sizeof(magic));
+    probe.close();
+
+    if (std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0) {
+        return std::unique_ptr<TraceReader>(new MappedTraceReader(path));
+    }
+    if (std::memcmp(magic, "L1TZ", sizeof(magic)) == 0) {
+        return std::unique_ptr<TraceReader>(new CompressedTraceReader(path));
+    }
+    if (readAhead) return std::unique_ptr<TraceReader>(new ReadAheadTraceReader(path));
+    return std::unique_ptr<TraceReader>(new TextTraceReader(path));
+}
+
+//
+// TextTraceReader
+//
+TextTraceReader::TextTraceReader(const std::string& path)
+    : path(path), text(TEXT_BLOCK_BYTES), textBegin(0), textEnd(0), atEof(false), line(0), buffer(TEXT_CHUNK_RECORDS) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open trace file: " + path);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+TextTraceReader::~TextTraceReader() {
+    ::close(fd);
+}
+
+bool TextTraceReader::refill() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (;;) {
+        size_t produced;
+        size_t used = parseTraceText(text.data() + textBegin, textEnd - textBegin, atEof,
+                                     buffer.data(), buffer.size(), produced, path, line);
+        textBegin += used;
+        stats.bytes += used;
+        if (produced > 0) {
+            stats.records += produced;
+            stats.seconds += nanosSince(start) * 1e-9;
+            cur = buffer.data();
+            end = cur + produced;
+            return true;
+        }
+        if (atEof) break;
+        atEof = !readText(fd, text, textBegin, textEnd, path);
+    }
+    stats.seconds += nanosSince(start) * 1e-9;
+    return false;
+}
+
+//
+// ReadAheadTraceReader
+//
+ReadAheadTraceReader::ReadAheadTraceReader(const std::string& path)
+    : path(path), full(READ_AHEAD_BATCHES), empty(READ_AHEAD_BATCHES), current(nullptr),
+      done(false), stop(false), failed(false), bytesDecoded(0), recordsDecoded(0), decodeNanos(0),
+      waitSeconds(0) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open trace file: " + path);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    for (size_t i = 0; i < READ_AHEAD_BATCHES; i++) {
+        batches.push_back(std::unique_ptr<Batch>(new Batch));
+        batches[i]->records.resize(READ_AHEAD_BATCH_RECORDS);
+        batches[i]->count = 0;
+        empty.push(batches[i].get());
+    }
+    producer = std::thread(&ReadAheadTraceReader::produce, this);
+}
+
+ReadAheadTraceReader::~ReadAheadTraceReader() {
+    stop.store(true);
+    batchFree.ring();
+    producer.join();
+    ::close(fd);
+}
+
+void ReadAheadTraceReader::produce() {
+    std::vector<char> text(TEXT_BLOCK_BYTES);
+    size_t textBegin = 0, textEnd = 0;
+    bool atEof = false;
+    uint64_t line = 0;
+    Batch* batch = nullptr;
+    try {
+        for (;;) {
+            if (!batch) {
+                batchFree.wait([this, &batch] { return stop.load() || empty.pop(batch); }, READ_AHEAD_SPINS);
+                if (!batch) return;
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            size_t produced;
+            size_t used = parseTraceText(text.data() + textBegin, textEnd - textBegin, atEof,
+                                         batch->records.data() + batch->count,
+                                         batch->records.size() - batch->count, produced, path, line);
+            textBegin += used;
+            batch->count += produced;
+            bool drained = atEof && textBegin == textEnd;
+            if (!drained && batch->count < batch->records.size()) {
+                atEof = !readText(fd, text, textBegin, textEnd, path);
+            }
+            bytesDecoded.fetch_add(used, std::memory_order_relaxed);
+            recordsDecoded.fetch_add(produced, std::memory_order_relaxed);
+            decodeNanos.fetch_add((uint64_t)nanosSince(start), std::memory_order_relaxed);
+
+            if (batch->count == batch->records.size() || (drained && batch->count > 0)) {
+                full.push(batch); // never fails: the rings hold every batch
+                batch = nullptr;
+                batchReady.ring();
+            }
+            if (drained) break;
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+        failed.store(true);
+    }
+    done.store(true, std::memory_order_release);
+    batchReady.ring();
+}
+
+bool ReadAheadTraceReader::refill() {
+    if (current) {
+        current->count = 0;
+        empty.push(current);
+        current = nullptr;
+        batchFree.ring();
+    }
+    if (!full.pop(current)) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        batchReady.wait([this] {
+            // Check done first: a batch pushed before done was set is then
+            // guaranteed to be visible to the pop after it
+            bool finished = done.load(std::memory_order_acquire);
+            return full.pop(current) || finished;
+        }, READ_AHEAD_SPINS);
+        waitSeconds += nanosSince(start) * 1e-9;
+        if (!current) {
+            if (failed.load()) throw std::runtime_error(error);
+            return false;
+        }
+    }
+    cur = current->records.data();
+    end = cur + current->count;
+    return true;
+}
+
+DecodeStats ReadAheadTraceReader::getDecodeStats() const {
+    DecodeStats stats;
+    stats.bytes = bytesDecoded.load(std::memory_order_relaxed);
+    stats.records = recordsDecoded.load(std::memory_order_relaxed);
+    stats.seconds = decodeNanos.load(std::memory_order_relaxed) * 1e-9;
+    stats.waitSeconds = waitSeconds;
+    return stats;
+}
+
+//
+// MappedTraceReader
+//
+MappedTraceReader::MappedTraceReader(const std::string& path) : base(nullptr), length(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open trace file: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("truncated binary trace: " + path);
+    }
+    length = (size_t)st.st_size;
+    base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        throw std::runtime_error("cannot map trace file: " + path);
+    }
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    std::memcpy(&header, base, sizeof(header));
+    uint64_t available = (length - sizeof(TraceFileHeader)) / sizeof(TraceRecord);
+    if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        header.version != TRACE_FORMAT_VERSION || header.recordCount > available) {
+        munmap(base, length);
+        base = nullptr;
+        throw std::runtime_error("bad binary trace header: " + path);
+    }
+
+    cur = reinterpret_cast<const TraceRecord*>(static_cast<const char*>(base) + sizeof(TraceFileHeader));
+    end = cur + header.recordCount;
+}
+
+MappedTraceReader::~MappedTraceReader() {
+    if (base) munmap(base, length);
+}
+
+//
+// TraceSet
+//
+TraceSet::TraceSet(const std::string& prefix, int numCores) : prefix(prefix) {
+    if (numCores <= 0) numCores = findCoreCount(prefix);
+    if (numCores <= 0) throw std::runtime_error("no traces found for " + prefix);
+    // Open every core first so that all text traces decode in parallel
+    std::vector<std::unique_ptr<TraceReader> > readers;
+    for (int i = 0; i < numCores; i++) readers.push_back(TraceReader::openCore(prefix, i, true));
+    traces.resize(numCores);
+    for (int i = 0; i < numCores; i++) {
+        TraceRecord record;
+        while (readers[i]->next(record)) traces[i].push_back(record);
+        readers[i].reset();
+    }
+    findAddressBits();
+}
+
+TraceSet::TraceSet(const std::string& prefix, std::vector<std::vector<TraceRecord> >& generated)
+    : prefix(prefix) {
+    traces.swap(generated);
+    findAddressBits();
+}
+
+void TraceSet::findAddressBits() {
+    addressBits = 32;
+    for (size_t i = 0; i < traces.size() && addressBits == 32; i++) addressBits = addressBitsOf(traces[i]);
+}
+
+uint64_t TraceSet::getReferenceCount() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < traces.size(); i++) total += traces[i].size();
+    return total;
+}
+
+//
+// Conversion
+//
+TraceFileHeader makeTraceHeader(uint32_t coreId, uint64_t recordCount) {
+    TraceFileHeader header;
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_FORMAT_VERSION;
+    header.coreId = coreId;
+    header.reserved = 0;
+    header.recordCount = recordCount;
+    return header;
+}
+
+uint64_t convertTextTrace(const std::string& textPath, const std::string& binPath, uint32_t coreId) {
+    TextTraceReader reader(textPath);
+    std::ofstream out(binPath.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("cannot create binary trace: " + binPath);
+    }
+
+    TraceFileHeader header = makeTraceHeader(coreId, 0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<TraceRecord> chunk;
+    chunk.reserve(TEXT_CHUNK_RECORDS);
+    TraceRecord record;
+    while (reader.next(record)) {
+        chunk.push_back(record);
+        if (chunk.size() == TEXT_CHUNK_RECORDS) {
+            out.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(TraceRecord));
+            header.recordCount += chunk.size();
+            chunk.clear();
+        }
+    }
+    out.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(TraceRecord));
+    header.recordCount += chunk.size();
+
+    // Patch the record count now that it is known
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) {
+        throw std::runtime_error("failed writing binary trace: " + binPath);
+    }
+    return header.recordCount;
+}
@@ -0,0 +1,251 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include "utils.h"
+#include "SpscRing.h"
+#include "Doorbell.h"
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+
+// Trace addresses are 63-bit: one past the largest one a record can hold.
+// Text traces with a wider address are rejected with the line number.
+const uint64_t TRACE_ADDRESS_LIMIT = 1ull << 63;
+
+// One memory reference. The same 8-byte word is used in memory and on disk
+// in the binary trace format: bit 0 is the operation (0 = R, 1 = W) and the
+// remaining bits hold the byte address, which must be below
+// TRACE_ADDRESS_LIMIT.
+struct TraceRecord {
+    uint64_t word;
+
+    MemoryOperation op() const { return (word & 1) ? WRITE : READ; }
+    uint64_t address() const { return word >> 1; }
+
+    static TraceRecord make(MemoryOperation op, uint64_t address) {
+        TraceRecord r;
+        r.word = (address << 1) | (op == WRITE ? 1 : 0);
+        return r;
+    }
+};
+
+// Binary trace file layout (host byte order, little-endian in practice):
+//   TraceFileHeader, then recordCount TraceRecords back to back.
+struct TraceFileHeader {
+    char magic[4];          // "L1TB"
+    uint32_t version;       // TRACE_FORMAT_VERSION
+    uint32_t coreId;        // K in appN_procK
+    uint32_t reserved;
+    uint64_t recordCount;
+};
+
+const uint32_t TRACE_FORMAT_VERSION = 1;
+
+// Parse one "R 0x..." / "W 0x..." text line. Returns false for blank or
+// malformed lines; throws if the address does not fit in 63 bits.
+bool parseTraceLine(const char* line, TraceRecord& record);
+
+// Parse the complete lines of text[0, length) into out (at most capacity
+// records). Returns the number of bytes consumed, which stops after the last
+// newline seen, or at the end of the text if atEnd. Malformed lines are
+// skipped. line counts the lines of path consumed so far; an address that
+// does not fit in 63 bits throws, naming path and its line.
+size_t parseTraceText(const char* text, size_t length, bool atEnd,
+                      TraceRecord* out, size_t capacity, size_t& produced,
+                      const std::string& path, uint64_t& line);
+
+// Work spent turning trace text into records
+struct DecodeStats {
+    uint64_t bytes;
+    uint64_t records;
+    double seconds;    // time spent reading and parsing, not waiting
+    double waitSeconds; // time the simulation thread waited for decoded records
+
+    DecodeStats() : bytes(0), records(0), seconds(0), waitSeconds(0) {}
+};
+
+// Path of the trace for one core: prefers "<prefix>_procK.bin", then the
+// compressed "<prefix>_procK.ctr", and falls back to "<prefix>_procK.trace".
+std::string resolveTracePath(const std::string& prefix, int coreId);
+
+// "dir/app2_proc3.trace" -> "dir/app2" (and 3 in coreId, if given); empty if
+// path does not name a per-core trace file
+std::string tracePrefixOf(const std::string& path, int* coreId = nullptr);
+
+// Number of cores a trace set has: one more than the highest K for which
+// "<prefix>_procK" exists, 0 if there is none
+int findCoreCount(const std::string& prefix);
+
+// Address width a set of records needs: 32 if every address fits in 32
+// bits, else 64
+int addressBitsOf(const std::vector<TraceRecord>& records);
+// The same over the first maxRecords records of each of the numCores
+// traces of prefix (0 = every core findCoreCount discovers); cores without a
+// trace are skipped
+int traceAddressBits(const std::string& prefix, int numCores, uint64_t maxRecords);
+
+// Sequential reader over one core's trace. Records are handed out of a
+// window [cur, end); refill() is only called when the window runs dry, so
+// the per-reference cost is a pointer bump.
+class TraceReader {
+protected:
+    const TraceRecord* cur;
+    const TraceRecord* end;
+
+    TraceReader() : cur(nullptr), end(nullptr) {}
+    virtual bool refill() = 0;
+
+public:
+    virtual ~TraceReader() {}
+
+    bool next(TraceRecord& record) {
+        if (cur == end && !refill()) return false;
+        record = *cur++;
+        return true;
+    }
+
+    // Skip up to count records; returns how many were skipped
+    virtual uint64_t skip(uint64_t count);
+
+    // Decoding done so far; zero for formats that need none
+    virtual DecodeStats getDecodeStats() const { return DecodeStats(); }
+
+    // Opens a text or binary trace based on the file contents. Text traces
+    // are decoded on a read-ahead thread if readAhead is set.
+    static std::unique_ptr<TraceReader> open(const std::string& path, bool readAhead = false);
+    // Opens core coreId's trace of prefix. A core with no trace file gets an
+    // empty trace (with a warning) so gaps in _procK numbering stay idle.
+    static std::unique_ptr<TraceReader> openCore(const std::string& prefix, int coreId, bool readAhead = false);
+};
+
+// "R 0x..." text traces, decoded a chunk at a time on the calling thread.
+class TextTraceReader : public TraceReader {
+private:
+    std::string path;
+    int fd;
+    std::vector<char> text;
+    size_t textBegin, textEnd;  // undecoded bytes in text
+    bool atEof;
+    uint64_t line;              // lines decoded so far
+    std::vector<TraceRecord> buffer;
+    DecodeStats stats;
+
+protected:
+    bool refill();
+
+public:
+    explicit TextTraceReader(const std::string& path);
+    ~TextTraceReader();
+
+    DecodeStats getDecodeStats() const { return stats; }
+};
+
+// Text traces decoded ahead of use by a producer thread. The producer reads
+// large blocks, parses them into batches and passes full batches to the
+// simulation thread over one lock-free ring; empty batches come back over a
+// second ring, so nothing is allocated once the pipeline is running. The
+// consumer only waits when every decoded batch has been used up, and the
+// producer when every batch is full; either side yields a few times and then
+// sleeps on a Doorbell until the other hands it a batch.
+class ReadAheadTraceReader : public TraceReader {
+private:
+    struct Batch {
+        std::vector<TraceRecord> records;
+        size_t count;
+    };
+
+    std::string path;
+    int fd;
+    std::vector<std::unique_ptr<Batch> > batches;
+    SpscRing<Batch*> full;      // producer -> consumer
+    SpscRing<Batch*> empty;     // consumer -> producer
+    Batch* current;             // batch the consumer is reading
+    std::atomic<bool> done;     // producer pushed its last batch
+    std::atomic<bool> stop;     // consumer is going away
+    std::atomic<bool> failed;
+    std::string error;          // why the producer failed; read once done is set
+    std::atomic<uint64_t> bytesDecoded, recordsDecoded, decodeNanos;
+    double waitSeconds;         // consumer side only
+    Doorbell batchReady;        // a full batch, or done
+    Doorbell batchFree;         // an empty batch, or stop
+    std::thread producer;
+
+    void produce();
+
+protected:
+    bool refill();
+
+public:
+    explicit ReadAheadTraceReader(const std::string& path);
+    ~ReadAheadTraceReader();
+
+    DecodeStats getDecodeStats() const;
+};
+
+// Binary traces, mapped read-only; records are read straight out of the
+// mapping with no copies.
+class MappedTraceReader : public TraceReader {
+private:
+    void* base;
+    size_t length;
+    TraceFileHeader header;
+
+protected:
+    bool refill() { return false; }
+
+public:
+    explicit MappedTraceReader(const std::string& path);
+    ~MappedTraceReader();
+
+    const TraceFileHeader& getHeader() const { return header; }
+};
+
+// Reader over records already decoded into memory. The records are shared
+// read-only, so any number of readers can walk the same trace at once.
+class MemoryTraceReader : public TraceReader {
+protected:
+    bool refill() { return false; }
+
+public:
+    explicit MemoryTraceReader(const std::vector<TraceRecord>& records) {
+        cur = records.data();
+        end = cur + records.size();
+    }
+};
+
+// All per-core traces of one application, decoded once into memory so that
+// several simulations can replay them without touching the files again.
+class TraceSet {
+private:
+    std::string prefix;
+    std::vector<std::vector<TraceRecord> > traces;
+    int addressBits;
+
+    void findAddressBits();
+
+public:
+    // numCores of 0 means every core findCoreCount discovers
+    TraceSet(const std::string& prefix, int numCores = 0);
+    // Adopt traces that were generated in memory
+    TraceSet(const std::string& prefix, std::vector<std::vector<TraceRecord> >& traces);
+
+    const std::string& getPrefix() const { return prefix; }
+    int getNumCores() const { return (int)traces.size(); }
+    uint64_t getReferenceCount() const;
+    int getAddressBits() const { return addressBits; }  // see addressBitsOf
+    std::unique_ptr<TraceReader> openReader(int coreId) const {
+        return std::unique_ptr<TraceReader>(new MemoryTraceReader(traces[coreId]));
+    }
+};
+
+// Header of a binary trace holding recordCount records for core coreId
+TraceFileHeader makeTraceHeader(uint32_t coreId, uint64_t recordCount);
+
+// Writes a text trace out in the binary format. Returns the record count.
+uint64_t convertTextTrace(const std::string& textPath, const std::string& binPath, uint32_t coreId);
+
+#endif // TRACE_READER_H
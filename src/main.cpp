@@ -1,42 +1,154 @@
 #include "CacheSimulator.h"
+#include "Sweep.h"
+#include "StackDistance.h"
+#include "Batch.h"
 #include <iostream>
 #include <string>
 #include <cstdlib>
 #include <getopt.h>
+#include <thread>
 
 void printHelp() {
     std::cout << "Usage: ./L1simulate -t <tracefile> -s <s> -E <E> -b <b> [-o <outfilename>] [-d] [-h]" << std::endl;
     std::cout << "Options:" << std::endl;
-    std::cout << "  -t <tracefile>: name of parallel application (e.g. app1) whose 4 traces are to be used" << std::endl;
+    std::cout << "  -t <tracefile>: name of parallel application (e.g. app1) whose _procK traces are to be used" << std::endl;
+    std::cout << "  -n, --cores <cores>: number of cores (default: one per _procK trace found)" << std::endl;
     std::cout << "  -s <s>: number of set index bits (number of sets in the cache = S = 2^s)" << std::endl;
     std::cout << "  -E <E>: associativity (number of cache lines per set)" << std::endl;
     std::cout << "  -b <b>: number of block bits (block size = B = 2^b)" << std::endl;
     std::cout << "  -o <outfilename>: logs output in file for plotting etc." << std::endl;
-    std::cout << "  -d: enable debug mode (prints cache state after each instruction)" << std::endl;
+    std::cout << "  -d: enable debug mode (prints every simulation event as text)" << std::endl;
+    std::cout << "  --events <file>: write binary simulation events to file (decode with bin/decode_events)" << std::endl;
+    std::cout << "  --trace-level <1|2>: events to record: 1 = coherence only, 2 = also accesses and hits (default)" << std::endl;
+    std::cout << "  --event-ring <n>: keep only the last n events (flight recorder), written at the end" << std::endl;
+    std::cout << "  --engine <event|cycle|parallel|parallel-relaxed>: advance time event by event (default)," << std::endl;
+    std::cout << "      tick every cycle, or run each core on its own thread between bus events" << std::endl;
+    std::cout << "  --quantum <cycles>: parallel-relaxed: how far a core may run past the earliest pending event (default: 1000)" << std::endl;
+    std::cout << "  --check-data: carry block contents and check every read sees the latest write" << std::endl;
+    std::cout << "  --bus <atomic|split>: one transaction at a time (default), or split address/data phases" << std::endl;
+    std::cout << "  --mem-requests <n>: split bus: memory requests outstanding at once (default: 4)" << std::endl;
+    std::cout << "  --bus-stats: print per-transaction-type bus occupancy (always on with --bus split)" << std::endl;
+    std::cout << "  --address-bits <32|64>: address and tag width (default: 32 unless the traces go above 4 GB)" << std::endl;
+    std::cout << "  --generic-kernels: use the run-time geometry lookup path instead of a specialised one" << std::endl;
+    std::cout << "  --replacement <lru|plru|srrip|brrip|nru|random>: replacement policy (default: lru)" << std::endl;
+    std::cout << "  --scalar-tags: compare a set's tags one at a time instead of with SSE/AVX2" << std::endl;
+    std::cout << "  --no-read-ahead: decode text traces on the simulation thread instead of one producer per core" << std::endl;
+    std::cout << "  --checkpoint <file>: save the full simulator state to file on --stop-at, --checkpoint-every," << std::endl;
+    std::cout << "      SIGUSR1 (then continue) or SIGINT/SIGTERM (then stop)" << std::endl;
+    std::cout << "  --checkpoint-every <cycles>: also checkpoint every so many cycles" << std::endl;
+    std::cout << "  --stop-at <cycle>: stop once the given cycle is reached and print the statistics so far" << std::endl;
+    std::cout << "  --restore <file>: continue from a checkpoint taken with the same traces, -s, -E and -b" << std::endl;
+    std::cout << "  --reset-stats: with --restore, count statistics from the restored cycle only" << std::endl;
+    std::cout << "  --sample <period>: sampled simulation: measure one unit every <period> references per core" << std::endl;
+    std::cout << "      and only warm caches functionally in between; prints estimates with 99.7% intervals" << std::endl;
+    std::cout << "  --sample-warmup <n>: detailed references per core before each unit (default: 2000)" << std::endl;
+    std::cout << "  --sample-unit <n>: measured references per core per unit (default: 1000)" << std::endl;
+    std::cout << "  --sample-fast-forward: skip the references between units instead of warming caches with them" << std::endl;
+    std::cout << "  --bench: print simulator construction/run time, throughput and peak RSS" << std::endl;
+    std::cout << "  --profile: after the statistics, break the simulator's own run time down by phase" << std::endl;
+    std::cout << "      (trace reading, cache lookup, coherence, bus, statistics) with event counts" << std::endl;
+    std::cout << "  --interval-cycles <n>: write a row of statistics per core every <n> cycles to --interval-out" << std::endl;
+    std::cout << "  --interval-refs <n>: ... or every <n> references retired by all cores together" << std::endl;
+    std::cout << "  --interval-out <file>: interval rows (.json/.jsonl for JSON lines, else CSV)" << std::endl;
+    std::cout << "  --summary <file>: also write the final statistics to file as one JSON object" << std::endl;
+    std::cout << "  --hot-blocks <k>: after the statistics, list the <k> blocks with the most invalidations," << std::endl;
+    std::cout << "      cache-to-cache transfers and WriteBackOnOtherReadMiss writebacks, and the core pairs involved" << std::endl;
+    std::cout << "  -j <jobs>: worker threads for a sweep (default: all hardware threads)" << std::endl;
+    std::cout << "  --stack-distance <Emax>: one-pass LRU miss-rate curve for E = 1..Emax at the given -s" << std::endl;
+    std::cout << "      (-b may be a list for a block-size sweep); CSV to -o or stdout" << std::endl;
+    std::cout << "  --batch <dir|glob>: simulate every trace prefix found there with one configuration;" << std::endl;
+    std::cout << "      results stream to -o (.json/.jsonl for JSON lines, else CSV) or stdout" << std::endl;
+    std::cout << "  --max-loaded <n>: batch runs holding decoded traces at once (default: -j)" << std::endl;
     std::cout << "  -h: prints this help" << std::endl;
+    std::cout << "Sweep mode: give -s, -E and/or -b a list or range (e.g. -s 4-8 -E 1,2,4,8)" << std::endl;
+    std::cout << "  to simulate every combination and write one CSV row per configuration to -o (or stdout)." << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     std::string traceFile;
     int s = 0, E = 0, b = 0;
+    std::string sSpec, ESpec, bSpec;
+    int jobs = (int)std::thread::hardware_concurrency();
+    int stackDistanceMax = 0;
+    std::string batchPattern;
+    int maxLoaded = 0;
+    std::string restoreFile;
+    bool resetStats = false;
     std::string outFileName;
     bool debugMode = false;
+    SimulatorOptions options;
+
+    enum { OPT_ENGINE = 256, OPT_CHECK_DATA, OPT_BENCH, OPT_STACK_DISTANCE, OPT_BATCH, OPT_MAX_LOADED,
+           OPT_BUS, OPT_MEM_REQUESTS, OPT_BUS_STATS, OPT_EVENTS, OPT_TRACE_LEVEL, OPT_EVENT_RING,
+           OPT_NO_READ_AHEAD, OPT_CHECKPOINT, OPT_CHECKPOINT_EVERY, OPT_STOP_AT, OPT_RESTORE,
+           OPT_RESET_STATS, OPT_SAMPLE, OPT_SAMPLE_WARMUP, OPT_SAMPLE_UNIT,
+           OPT_SAMPLE_FAST_FORWARD, OPT_QUANTUM, OPT_PROFILE, OPT_ADDRESS_BITS,
+           OPT_GENERIC_KERNELS, OPT_SCALAR_TAGS, OPT_REPLACEMENT,
+           OPT_INTERVAL_CYCLES, OPT_INTERVAL_REFS, OPT_INTERVAL_OUT, OPT_SUMMARY, OPT_HOT_BLOCKS };
+    static const struct option longOptions[] = {
+        { "engine", required_argument, nullptr, OPT_ENGINE },
+        { "check-data", no_argument,   nullptr, OPT_CHECK_DATA },
+        { "bench",  no_argument,       nullptr, OPT_BENCH },
+        { "stack-distance", required_argument, nullptr, OPT_STACK_DISTANCE },
+        { "batch",  required_argument, nullptr, OPT_BATCH },
+        { "max-loaded", required_argument, nullptr, OPT_MAX_LOADED },
+        { "bus",    required_argument, nullptr, OPT_BUS },
+        { "mem-requests", required_argument, nullptr, OPT_MEM_REQUESTS },
+        { "bus-stats", no_argument,    nullptr, OPT_BUS_STATS },
+        { "events", required_argument, nullptr, OPT_EVENTS },
+        { "trace-level", required_argument, nullptr, OPT_TRACE_LEVEL },
+        { "event-ring", required_argument, nullptr, OPT_EVENT_RING },
+        { "no-read-ahead", no_argument, nullptr, OPT_NO_READ_AHEAD },
+        { "checkpoint", required_argument, nullptr, OPT_CHECKPOINT },
+        { "checkpoint-every", required_argument, nullptr, OPT_CHECKPOINT_EVERY },
+        { "stop-at", required_argument, nullptr, OPT_STOP_AT },
+        { "restore", required_argument, nullptr, OPT_RESTORE },
+        { "reset-stats", no_argument, nullptr, OPT_RESET_STATS },
+        { "sample", required_argument, nullptr, OPT_SAMPLE },
+        { "sample-warmup", required_argument, nullptr, OPT_SAMPLE_WARMUP },
+        { "sample-unit", required_argument, nullptr, OPT_SAMPLE_UNIT },
+        { "sample-fast-forward", no_argument, nullptr, OPT_SAMPLE_FAST_FORWARD },
+        { "quantum", required_argument, nullptr, OPT_QUANTUM },
+        { "profile", no_argument, nullptr, OPT_PROFILE },
+        { "address-bits", required_argument, nullptr, OPT_ADDRESS_BITS },
+        { "generic-kernels", no_argument, nullptr, OPT_GENERIC_KERNELS },
+        { "scalar-tags", no_argument, nullptr, OPT_SCALAR_TAGS },
+        { "replacement", required_argument, nullptr, OPT_REPLACEMENT },
+        { "interval-cycles", required_argument, nullptr, OPT_INTERVAL_CYCLES },
+        { "interval-refs", required_argument, nullptr, OPT_INTERVAL_REFS },
+        { "interval-out", required_argument, nullptr, OPT_INTERVAL_OUT },
+        { "summary", required_argument, nullptr, OPT_SUMMARY },
+        { "hot-blocks", required_argument, nullptr, OPT_HOT_BLOCKS },
+        { "cores",  required_argument, nullptr, 'n' },
+        { "help",   no_argument,       nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
     
     // Parse command line arguments
     int opt;
-    while ((opt = getopt(argc, argv, "t:s:E:b:o:dh")) != -1) {
+    while ((opt = getopt_long(argc, argv, "t:s:E:b:o:j:n:dh", longOptions, nullptr)) != -1) {
         switch (opt) {
             case 't':
                 traceFile = optarg;
                 break;
             case 's':
-                s = std::stoi(optarg);
+                sSpec = optarg;
                 break;
             case 'E':
-                E = std::stoi(optarg);
+                ESpec = optarg;
                 break;
             case 'b':
-                b = std::stoi(optarg);
+                bSpec = optarg;
+                break;
+            case 'j':
+                jobs = std::stoi(optarg);
+                break;
+            case 'n':
+                options.numCores = std::stoi(optarg);
+                if (options.numCores <= 0) {
+                    std::cerr << "Error: Invalid core count (-n)" << std::endl;
+                    return 1;
+                }
                 break;
             case 'o':
                 outFileName = optarg;
@@ -44,6 +156,177 @@ int main(int argc, char* argv[]) {
             case 'd':
                 debugMode = true;
                 break;
+            case OPT_ENGINE:
+                if (std::string(optarg) == "event") {
+                    options.eventDriven = true;
+                } else if (std::string(optarg) == "cycle") {
+                    options.eventDriven = false;
+                } else if (std::string(optarg) == "parallel" || std::string(optarg) == "parallel-relaxed") {
+                    options.parallel = true;
+                    options.relaxed = std::string(optarg) == "parallel-relaxed";
+                } else {
+                    std::cerr << "Error: Unknown engine: " << optarg << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_CHECK_DATA:
+                options.checkData = true;
+                break;
+            case OPT_BENCH:
+                options.reportPerformance = true;
+                break;
+            case OPT_PROFILE:
+                options.profile = true;
+                break;
+            case OPT_BUS:
+                if (std::string(optarg) == "atomic") {
+                    options.splitBus = false;
+                } else if (std::string(optarg) == "split") {
+                    options.splitBus = true;
+                } else {
+                    std::cerr << "Error: Unknown bus model: " << optarg << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_ADDRESS_BITS:
+                options.addressBits = std::stoi(optarg);
+                if (options.addressBits != 32 && options.addressBits != 64) {
+                    std::cerr << "Error: Address width must be 32 or 64 (--address-bits)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_GENERIC_KERNELS:
+                options.genericKernels = true;
+                break;
+            case OPT_SCALAR_TAGS:
+                options.scalarTags = true;
+                break;
+            case OPT_REPLACEMENT:
+                if (!parseReplacement(optarg, options.replacement)) {
+                    std::cerr << "Error: Invalid replacement policy (--replacement)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_INTERVAL_CYCLES:
+                options.intervalCycles = std::stoll(optarg);
+                if (options.intervalCycles <= 0) {
+                    std::cerr << "Error: Invalid interval (--interval-cycles)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_INTERVAL_REFS:
+                options.intervalReferences = std::stoll(optarg);
+                if (options.intervalReferences <= 0) {
+                    std::cerr << "Error: Invalid interval (--interval-refs)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_INTERVAL_OUT:
+                options.intervalFile = optarg;
+                break;
+            case OPT_SUMMARY:
+                options.summaryFile = optarg;
+                break;
+            case OPT_HOT_BLOCKS:
+                options.hotBlocks = std::stoi(optarg);
+                if (options.hotBlocks <= 0 || options.hotBlocks > (1 << 20)) {
+                    std::cerr << "Error: Invalid number of hot blocks (--hot-blocks)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_MEM_REQUESTS:
+                options.memoryRequests = std::stoi(optarg);
+                if (options.memoryRequests <= 0) {
+                    std::cerr << "Error: Invalid number of memory requests" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_BUS_STATS:
+                options.reportBus = true;
+                break;
+            case OPT_EVENTS:
+                options.eventFile = optarg;
+                break;
+            case OPT_TRACE_LEVEL:
+                options.traceLevel = std::stoi(optarg);
+                if (options.traceLevel < TRACE_COHERENCE || options.traceLevel > TRACE_ALL) {
+                    std::cerr << "Error: Invalid trace level (--trace-level)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_EVENT_RING:
+                options.eventRing = std::stoul(optarg);
+                break;
+            case OPT_NO_READ_AHEAD:
+                options.readAhead = false;
+                break;
+            case OPT_CHECKPOINT:
+                options.checkpointFile = optarg;
+                break;
+            case OPT_CHECKPOINT_EVERY:
+                options.checkpointEvery = std::stoll(optarg);
+                if (options.checkpointEvery <= 0) {
+                    std::cerr << "Error: Invalid checkpoint interval (--checkpoint-every)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_STOP_AT:
+                options.stopAt = std::stoll(optarg);
+                if (options.stopAt <= 0) {
+                    std::cerr << "Error: Invalid stop cycle (--stop-at)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_RESTORE:
+                restoreFile = optarg;
+                break;
+            case OPT_RESET_STATS:
+                resetStats = true;
+                break;
+            case OPT_SAMPLE:
+                options.samplePeriod = std::stoi(optarg);
+                if (options.samplePeriod <= 0) {
+                    std::cerr << "Error: Invalid sampling period (--sample)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_SAMPLE_WARMUP:
+                options.sampleWarmup = std::stoi(optarg);
+                if (options.sampleWarmup < 0) {
+                    std::cerr << "Error: Invalid sampling warmup (--sample-warmup)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_SAMPLE_UNIT:
+                options.sampleUnit = std::stoi(optarg);
+                if (options.sampleUnit <= 0) {
+                    std::cerr << "Error: Invalid sampling unit (--sample-unit)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_SAMPLE_FAST_FORWARD:
+                options.sampleFastForward = true;
+                break;
+            case OPT_QUANTUM:
+                options.quantum = std::stoi(optarg);
+                if (options.quantum <= 0) {
+                    std::cerr << "Error: Invalid quantum (--quantum)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_STACK_DISTANCE:
+                stackDistanceMax = std::stoi(optarg);
+                if (stackDistanceMax <= 0) {
+                    std::cerr << "Error: Invalid maximum associativity (--stack-distance)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_BATCH:
+                batchPattern = optarg;
+                break;
+            case OPT_MAX_LOADED:
+                maxLoaded = std::stoi(optarg);
+                break;
             case 'h':
                 printHelp();
                 return 0;
@@ -54,13 +337,141 @@ int main(int argc, char* argv[]) {
     }
     
     // Validate parameters
-    if (traceFile.empty()) {
+    if (traceFile.empty() && batchPattern.empty()) {
         std::cerr << "Error: Missing trace file prefix (-t)" << std::endl;
         printHelp();
         return 1;
     }
+
+    bool singleRun = stackDistanceMax <= 0 && batchPattern.empty() &&
+                     !isSweepList(sSpec) && !isSweepList(ESpec) && !isSweepList(bSpec);
+    if (!options.eventFile.empty() && !singleRun) {
+        std::cerr << "Error: --events needs a single simulation" << std::endl;
+        return 1;
+    }
+    bool checkpointing = !options.checkpointFile.empty() || options.checkpointEvery > 0 ||
+                         options.stopAt > 0 || !restoreFile.empty();
+    if (options.profile && !singleRun) {
+        std::cerr << "Error: --profile needs a single simulation" << std::endl;
+        return 1;
+    }
+    if (options.hotBlocks > 0 && !singleRun) {
+        std::cerr << "Error: --hot-blocks needs a single simulation" << std::endl;
+        return 1;
+    }
+    if (checkpointing && !singleRun) {
+        std::cerr << "Error: checkpoints need a single simulation" << std::endl;
+        return 1;
+    }
+    if (options.checkpointEvery > 0 && options.checkpointFile.empty()) {
+        std::cerr << "Error: --checkpoint-every needs --checkpoint" << std::endl;
+        return 1;
+    }
+    if (resetStats && restoreFile.empty()) {
+        std::cerr << "Error: --reset-stats needs --restore" << std::endl;
+        return 1;
+    }
+    bool intervals = options.intervalCycles > 0 || options.intervalReferences > 0;
+    if (intervals || !options.intervalFile.empty()) {
+        if (options.intervalCycles > 0 && options.intervalReferences > 0) {
+            std::cerr << "Error: give either --interval-cycles or --interval-refs, not both" << std::endl;
+            return 1;
+        }
+        if (!intervals || options.intervalFile.empty()) {
+            std::cerr << "Error: interval statistics need --interval-out and --interval-cycles or --interval-refs" << std::endl;
+            return 1;
+        }
+        if (!singleRun || options.parallel || options.samplePeriod > 0) {
+            std::cerr << "Error: interval statistics need a single simulation on the event or cycle engine" << std::endl;
+            return 1;
+        }
+    }
+    if (!options.summaryFile.empty() && !singleRun) {
+        std::cerr << "Error: --summary needs a single simulation (sweeps and batches already write CSV/JSON)" << std::endl;
+        return 1;
+    }
+    if (options.parallel) {
+        if (!singleRun || checkpointing || options.samplePeriod > 0) {
+            std::cerr << "Error: the parallel engine needs a single simulation without checkpoints or sampling" << std::endl;
+            return 1;
+        }
+        if (options.checkData || debugMode || !options.eventFile.empty()) {
+            std::cerr << "Error: the parallel engine supports neither --check-data nor -d/--events" << std::endl;
+            return 1;
+        }
+    }
+    if (options.samplePeriod > 0) {
+        if (!singleRun || checkpointing) {
+            std::cerr << "Error: --sample needs a single simulation without checkpoints" << std::endl;
+            return 1;
+        }
+        if (!options.eventDriven) {
+            std::cerr << "Error: --sample runs its detailed windows on the event engine" << std::endl;
+            return 1;
+        }
+        if (options.sampleWarmup + options.sampleUnit > options.samplePeriod) {
+            std::cerr << "Error: --sample period must cover --sample-warmup plus --sample-unit" << std::endl;
+            return 1;
+        }
+        if (options.sampleFastForward && options.checkData) {
+            std::cerr << "Error: --check-data needs every write, so it cannot fast-forward" << std::endl;
+            return 1;
+        }
+    }
+
+    // Stack-distance analysis covers every E at once and ignores -E
+    if (stackDistanceMax > 0) {
+        try {
+            if (sSpec.empty() || isSweepList(sSpec) || std::stoi(sSpec) <= 0 ||
+                std::stoi(sSpec) > MAX_GEOMETRY_BITS) {
+                std::cerr << "Error: --stack-distance needs a single set index bits value (-s)" << std::endl;
+                return 1;
+            }
+            runStackDistanceAnalysis(traceFile, std::stoi(sSpec), parseSweepList(bSpec),
+                                     stackDistanceMax, options.numCores, outFileName);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Lists or ranges for any of -s/-E/-b switch to sweep mode
+    if (isSweepList(sSpec) || isSweepList(ESpec) || isSweepList(bSpec)) {
+        try {
+            runSweep(traceFile, parseSweepList(sSpec), parseSweepList(ESpec), parseSweepList(bSpec),
+                     outFileName, jobs > 0 ? jobs : 1, options);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!sSpec.empty()) s = std::stoi(sSpec);
+    if (!ESpec.empty()) E = std::stoi(ESpec);
+    if (!bSpec.empty()) b = std::stoi(bSpec);
+
+    if (!batchPattern.empty()) {
+        if (s <= 0 || E <= 0 || b <= 0) {
+            std::cerr << "Error: --batch needs -s, -E and -b" << std::endl;
+            return 1;
+        }
+        if (s > MAX_GEOMETRY_BITS || b > MAX_GEOMETRY_BITS) {
+            std::cerr << "Error: -s and -b must be at most " << MAX_GEOMETRY_BITS << std::endl;
+            return 1;
+        }
+        try {
+            if (jobs <= 0) jobs = 1;
+            runBatch(batchPattern, s, E, b, outFileName, jobs, maxLoaded > 0 ? maxLoaded : jobs, options);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
     
-    if (s <= 0) {
+    if (s <= 0 || s > MAX_GEOMETRY_BITS) {
         std::cerr << "Error: Invalid set index bits (-s)" << std::endl;
         return 1;
     }
@@ -70,14 +481,15 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    if (b <= 0) {
+    if (b <= 0 || b > MAX_GEOMETRY_BITS) {
         std::cerr << "Error: Invalid block bits (-b)" << std::endl;
         return 1;
     }
     
     // Create and run the simulator
     try {
-        CacheSimulator simulator(traceFile, s, E, b, outFileName, debugMode);
+        CacheSimulator simulator(traceFile, s, E, b, outFileName, debugMode, options);
+        if (!restoreFile.empty()) simulator.restoreCheckpoint(restoreFile, resetStats);
         simulator.runSimulation();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -36,6 +36,13 @@ inline std::string stateToString(CacheLineState state) {
     }
 }
 
+// Hex representation of an address as it appears in trace files
+inline std::string addressToString(unsigned long long address) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << address;
+    return oss.str();
+}
+
 // Bus transaction types
 // enum BusTransaction {
 //     BUS_READ,
@@ -0,0 +1,401 @@
+// Throughput benchmark of the simulator. Runs a fixed set of configurations
+// (direct-mapped vs 16-way, 16 vs 4096 sets, 4 vs 32 cores) over the bundled
+// example traces and synthetic ones, and reports references per second,
+// ns per reference and peak RSS for each. Every case runs in a child process
+// of its own, so the RSS is that case's alone.
+//
+//   bench [--baseline file | --against bench] [--save-baseline file] [--tolerance pct] [--repeat n]
+//         [--processes n] [--case name] [--generic | --scalar]
+//
+// Raw throughput moves with the host and its load, so every run of a case
+// is paired with a fixed calibration loop timed just before it, and the
+// score is references per thousand calibration steps. Runs within one
+// process agree more closely than runs across processes (memory layout
+// differs), so each case runs in --processes children (default 3) of
+// --repeat runs each and the median score is reported. --against runs the
+// cases under another build of this tool in turn with this one and fails a
+// case whose median score ratio is more than --tolerance percent (default
+// 20) below it; --baseline does the same against stored scores, which only
+// holds up on a quiet host. --generic also runs every case on the run-time
+// geometry lookup path and reports the speedup of the specialised kernels
+// over it; --scalar does the same with SIMD tag compares against scalar ones.
+#include "CacheSimulator.h"
+#include "TraceReader.h"
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchCase {
+    std::string name;
+    std::string prefix;  // trace prefix, or empty for synthetic traces
+    int numCores;        // synthetic traces only
+    int refsPerCore;
+    int s, E, b;
+};
+
+struct BenchResult {
+    uint64_t references;
+    double seconds;      // median of the repeats
+    double score;        // median references per 1000 calibration steps
+    long peakRssKb;
+};
+
+// Calibration: a dependent walk through a 1 MB single-cycle permutation with
+// a little integer work per step, about the simulator's mix of cached loads
+// and arithmetic. A few milliseconds per run of a case.
+static const size_t CALIBRATION_SLOTS = 1 << 18;
+static const uint64_t CALIBRATION_STEPS = 1 << 21;
+
+static std::vector<uint32_t> makeCalibrationWalk() {
+    std::vector<uint32_t> walk(CALIBRATION_SLOTS);
+    for (size_t i = 0; i < walk.size(); i++) walk[i] = (uint32_t)i;
+    // Sattolo's shuffle: one cycle through every slot
+    std::mt19937 rng(1234);
+    for (size_t i = walk.size() - 1; i > 0; i--) std::swap(walk[i], walk[rng() % i]);
+    return walk;
+}
+
+static double calibrationSeconds(const std::vector<uint32_t>& walk) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint32_t at = 0;
+    uint64_t mix = 0;
+    for (uint64_t step = 0; step < CALIBRATION_STEPS; step++) {
+        at = walk[at];
+        mix = (mix ^ at) * 0x9E3779B97F4A7C15ull;
+        mix ^= mix >> 29;
+    }
+    volatile uint64_t sink = mix;
+    (void)sink;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// Per-core mix of a sequential private stream, random private references
+// and a small region every core shares, so that hits, capacity misses and
+// coherence traffic all occur.
+static std::vector<std::vector<TraceRecord> > makeTraces(int numCores, int refsPerCore) {
+    std::vector<std::vector<TraceRecord> > traces(numCores);
+    for (int core = 0; core < numCores; core++) {
+        std::mt19937 rng(4321 + core);
+        uint64_t privateBase = 0x10000000ull + ((uint64_t)core << 22);
+        uint64_t stream = 0;
+        traces[core].reserve(refsPerCore);
+        for (int i = 0; i < refsPerCore; i++) {
+            unsigned r = rng();
+            MemoryOperation op = (r % 4 == 0) ? WRITE : READ;
+            uint64_t address;
+            if (r % 16 < 10) {
+                stream = (stream + 4) % (256 * 1024);
+                address = privateBase + stream;
+            } else if (r % 16 < 15) {
+                address = privateBase + (uint64_t)((r >> 8) % (1 << 20)) * 4;
+            } else {
+                address = (uint64_t)((r >> 8) % 4096) * 4;
+            }
+            traces[core].push_back(TraceRecord::make(op, address));
+        }
+    }
+    return traces;
+}
+
+static std::vector<BenchCase> benchCases() {
+    std::vector<BenchCase> cases;
+    cases.push_back(BenchCase{ "app2-s6-E2-b5", "example_traces/app2", 0, 0, 6, 2, 5 });
+    cases.push_back(BenchCase{ "synth4-dm-16sets", "", 4, 500000, 4, 1, 6 });
+    cases.push_back(BenchCase{ "synth4-16way-16sets", "", 4, 500000, 4, 16, 6 });
+    cases.push_back(BenchCase{ "synth4-dm-4096sets", "", 4, 500000, 12, 1, 6 });
+    cases.push_back(BenchCase{ "synth4-16way-4096sets", "", 4, 500000, 12, 16, 6 });
+    cases.push_back(BenchCase{ "synth4-32way-16sets", "", 4, 500000, 4, 32, 6 });
+    cases.push_back(BenchCase{ "synth32-4way-64sets", "", 32, 62500, 6, 4, 6 });
+    return cases;
+}
+
+// Short cases are repeated until they have run this long in total
+static const double MIN_CASE_SECONDS = 0.3;
+
+// Runs in the child: simulate the case at least repeat times, with a
+// calibration loop before each run and after the last, and keep the medians
+static BenchResult runCase(const BenchCase& bench, int repeat, const SimulatorOptions& options) {
+    std::vector<std::vector<TraceRecord> > generated;
+    if (bench.prefix.empty()) generated = makeTraces(bench.numCores, bench.refsPerCore);
+    TraceSet traces = bench.prefix.empty() ? TraceSet("synthetic", generated) : TraceSet(bench.prefix);
+    std::vector<uint32_t> walk = makeCalibrationWalk();
+
+    BenchResult result;
+    result.references = traces.getReferenceCount();
+    std::vector<double> seconds, calibrations;
+    double total = 0;
+    for (int i = 0; i < repeat || (total < MIN_CASE_SECONDS && i < 1000); i++) {
+        calibrations.push_back(calibrationSeconds(walk));
+        CacheSimulator simulator(traces, bench.s, bench.E, bench.b, "", false, options);
+        simulator.simulate();
+        total += simulator.getRunSeconds();
+        seconds.push_back(simulator.getRunSeconds());
+    }
+    calibrations.push_back(calibrationSeconds(walk));
+    // Medians of each side: a single calibration loop is as noisy as a run
+    result.seconds = median(seconds);
+    result.score = 1000.0 * result.references * median(calibrations) / (result.seconds * CALIBRATION_STEPS);
+    result.peakRssKb = 0;
+    return result;
+}
+
+// Fork, run the case in the child and read its result back through a pipe.
+// Returns false if the child failed.
+static bool runIsolated(const BenchCase& bench, int repeat, const SimulatorOptions& options, BenchResult& result) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    std::cout.flush(); // or the child repeats the buffered output when it writes to cerr
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        int status = 0;
+        try {
+            BenchResult childResult = runCase(bench, repeat, options);
+            if (write(fds[1], &childResult, sizeof(childResult)) != (ssize_t)sizeof(childResult)) status = 1;
+        } catch (const std::exception& e) {
+            std::cerr << bench.name << ": " << e.what() << std::endl;
+            status = 1;
+        }
+        _exit(status);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) return false;
+    result.peakRssKb = usage.ru_maxrss;
+    return got == (ssize_t)sizeof(result) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Run the case in processes children; medians over the children
+static bool runMedian(const BenchCase& bench, int repeat, int processes, const SimulatorOptions& options,
+                      BenchResult& result) {
+    std::vector<double> seconds, scores;
+    result.peakRssKb = 0;
+    for (int i = 0; i < processes; i++) {
+        BenchResult child;
+        if (!runIsolated(bench, repeat, options, child) || child.seconds <= 0) return false;
+        result.references = child.references;
+        result.peakRssKb = std::max(result.peakRssKb, child.peakRssKb);
+        seconds.push_back(child.seconds);
+        scores.push_back(child.score);
+    }
+    result.seconds = median(seconds);
+    result.score = median(scores);
+    return true;
+}
+
+// Run the case under a build of this tool (--against) and read its --emit
+// line back. Returns false if it failed or printed no result.
+static bool runExternal(const std::string& other, const BenchCase& bench, int repeat, BenchResult& result) {
+    std::ostringstream command;
+    command << "'" << other << "' --emit --processes 1 --repeat " << repeat << " --case " << bench.name;
+    std::cout.flush();
+    FILE *pipe = popen(command.str().c_str(), "r");
+    if (!pipe) return false;
+    char line[256];
+    bool found = false;
+    while (fgets(line, sizeof(line), pipe)) {
+        std::istringstream fields(line);
+        std::string tag, name;
+        if (fields >> tag >> name >> result.references >> result.seconds >> result.score >> result.peakRssKb &&
+            tag == "result" && name == bench.name) {
+            found = true;
+        }
+    }
+    return pclose(pipe) == 0 && found && result.seconds > 0;
+}
+
+// Baseline file: one "name score" line per case, # for comments
+static std::map<std::string, double> loadBaseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path.c_str());
+    if (!in.is_open()) {
+        std::cerr << "Error: cannot open baseline " << path << std::endl;
+        exit(1);
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        double score;
+        if (fields >> name >> score) baseline[name] = score;
+    }
+    return baseline;
+}
+
+static void printUsage() {
+    std::cout << "Usage: ./bench [--baseline file | --against bench] [--save-baseline file] [--tolerance pct]"
+              << " [--repeat n] [--processes n] [--case name] [--generic | --scalar]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::string self = argv[0];
+    std::string baselinePath, savePath;
+    double tolerance = 20.0;
+    int repeat = 5;
+    int processes = 3;
+    std::string onlyCase, against;
+    bool emit = false;  // one "result" line per case for --against, no table
+    // --generic / --scalar: the options every case is also run with for comparison
+    SimulatorOptions compareOptions;
+    std::string compareName;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--baseline" && i + 1 < argc) baselinePath = argv[++i];
+        else if (arg == "--save-baseline" && i + 1 < argc) savePath = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc) tolerance = std::atof(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::atoi(argv[++i]);
+        else if (arg == "--processes" && i + 1 < argc) processes = std::atoi(argv[++i]);
+        else if (arg == "--case" && i + 1 < argc) onlyCase = argv[++i];
+        else if (arg == "--against" && i + 1 < argc) against = argv[++i];
+        else if (arg == "--emit") emit = true;
+        else if (arg == "--generic" && compareName.empty()) {
+            compareOptions.genericKernels = true;
+            compareName = "generic";
+        } else if (arg == "--scalar" && compareName.empty()) {
+            compareOptions.scalarTags = true;
+            compareName = "scalar";
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (repeat <= 0 || processes <= 0 || tolerance < 0 || (!against.empty() && !baselinePath.empty())) {
+        printUsage();
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselinePath.empty()) baseline = loadBaseline(baselinePath);
+
+    if (!emit) {
+        std::cout << std::left << std::setw(24) << "case" << std::right << std::setw(10) << "refs"
+                  << std::setw(10) << "seconds" << std::setw(12) << "refs/s" << std::setw(9) << "ns/ref"
+                  << std::setw(10) << "RSS (KB)" << std::setw(9) << "score";
+        if (!baseline.empty()) std::cout << std::setw(10) << "baseline" << std::setw(9) << "change";
+        if (!against.empty()) std::cout << std::setw(10) << "against" << std::setw(9) << "change";
+        if (!compareName.empty()) std::cout << std::setw(12) << compareName << std::setw(9) << "speedup";
+        std::cout << std::endl;
+    }
+
+    std::ostringstream saved;
+    saved << "# bench baseline: case score (references per 1000 calibration steps, median of "
+          << processes << " processes x " << repeat << "+ runs)" << std::endl;
+    int regressions = 0, failures = 0;
+    for (const BenchCase &bench : benchCases()) {
+        if (!onlyCase.empty() && bench.name != onlyCase) continue;
+        if (!bench.prefix.empty() && findCoreCount(bench.prefix) == 0) {
+            std::cout << std::left << std::setw(24) << bench.name << " skipped: no traces at " << bench.prefix << std::endl;
+            continue;
+        }
+        BenchResult result;
+        bool ran;
+        double againstScore = 0, change = 0;
+        if (against.empty()) {
+            ran = runMedian(bench, repeat, processes, SimulatorOptions(), result);
+            std::map<std::string, double>::const_iterator it = baseline.find(bench.name);
+            if (ran && it != baseline.end()) {
+                againstScore = it->second;
+                change = 100.0 * (result.score / againstScore - 1.0);
+            }
+        } else {
+            // Alternate the two builds run by run (ABBA...), so drift in the
+            // host's speed hits both alike, and compare the median ratio.
+            // This build runs the same way as the other one, in a fresh
+            // process of its own, not a fork of this long-lived one.
+            std::vector<double> seconds, scores, otherScores, ratios;
+            ran = true;
+            result.peakRssKb = 0;
+            for (int i = 0; i < processes && ran; i++) {
+                BenchResult mine, other;
+                bool otherFirst = i % 2 == 0;
+                ran = (!otherFirst || runExternal(against, bench, repeat, other)) &&
+                      runExternal(self, bench, repeat, mine) &&
+                      (otherFirst || runExternal(against, bench, repeat, other));
+                if (!ran) break;
+                result.references = mine.references;
+                result.peakRssKb = std::max(result.peakRssKb, mine.peakRssKb);
+                seconds.push_back(mine.seconds);
+                scores.push_back(mine.score);
+                otherScores.push_back(other.score);
+                ratios.push_back(mine.score / other.score);
+            }
+            if (ran) {
+                result.seconds = median(seconds);
+                result.score = median(scores);
+                againstScore = median(otherScores);
+                change = 100.0 * (median(ratios) - 1.0);
+            }
+        }
+        if (!ran) {
+            std::cout << std::left << std::setw(24) << bench.name << " FAILED" << std::endl;
+            failures++;
+            continue;
+        }
+        if (emit) {
+            std::cout << "result " << bench.name << " " << result.references << " " << std::setprecision(9)
+                      << result.seconds << " " << result.score << " " << result.peakRssKb << std::endl;
+            continue;
+        }
+        double refsPerSecond = result.references / result.seconds;
+        std::cout << std::left << std::setw(24) << bench.name << std::right << std::setw(10) << result.references
+                  << std::setw(10) << std::fixed << std::setprecision(3) << result.seconds
+                  << std::setw(12) << std::setprecision(0) << refsPerSecond
+                  << std::setw(9) << std::setprecision(1) << result.seconds * 1e9 / result.references
+                  << std::setw(10) << result.peakRssKb << std::setw(9) << std::setprecision(1) << result.score;
+        if (againstScore > 0) {
+            std::cout << std::setw(10) << std::setprecision(1) << againstScore
+                      << std::setw(8) << std::showpos << std::setprecision(1) << change << "%" << std::noshowpos;
+            if (change < -tolerance) {
+                std::cout << "  REGRESSION";
+                regressions++;
+            }
+        }
+        BenchResult compared;
+        if (!compareName.empty() && runMedian(bench, repeat, processes, compareOptions, compared)) {
+            std::cout << std::setw(12) << std::setprecision(0) << compared.references / compared.seconds
+                      << std::setw(8) << std::setprecision(2) << compared.seconds / result.seconds << "x";
+        }
+        std::cout << std::endl;
+        saved << bench.name << " " << std::fixed << std::setprecision(2) << result.score << std::endl;
+    }
+
+    if (!savePath.empty()) {
+        std::ofstream out(savePath.c_str());
+        out << saved.str();
+        if (!out) {
+            std::cerr << "Error: cannot write baseline " << savePath << std::endl;
+            return 1;
+        }
+        std::cout << "Baseline written to " << savePath << std::endl;
+    }
+    if (regressions > 0) {
+        std::cout << regressions << " case(s) more than " << tolerance << "% below "
+                  << (against.empty() ? "the baseline" : against) << std::endl;
+    }
+    return (regressions > 0 || failures > 0) ? 1 : 0;
+}
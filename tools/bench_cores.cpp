@@ -0,0 +1,58 @@
+// Measures how simulation cost scales with the core count. Each run replays
+// synthetic in-memory traces (a mix of private and shared blocks, so both
+// hits and coherence misses occur) for N = 1, 2, 4, ... 64 cores and reports
+// wall time, references per second and ns per reference.
+#include "CacheSimulator.h"
+#include "TraceReader.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::vector<std::vector<TraceRecord> > makeTraces(int numCores, int refsPerCore) {
+    std::vector<std::vector<TraceRecord> > traces(numCores);
+    for (int core = 0; core < numCores; core++) {
+        std::mt19937 rng(1234 + core);
+        uint64_t privateBase = 0x10000000ull + ((uint64_t)core << 20);
+        traces[core].reserve(refsPerCore);
+        for (int i = 0; i < refsPerCore; i++) {
+            unsigned r = rng();
+            MemoryOperation op = (r % 4 == 0) ? WRITE : READ;
+            // 1 in 8 references touches a small shared region
+            uint64_t address = (r % 8 == 0) ? (uint64_t)((r >> 8) % 4096) * 4
+                                            : privateBase + (uint64_t)((r >> 8) % 16384) * 4;
+            traces[core].push_back(TraceRecord::make(op, address));
+        }
+    }
+    return traces;
+}
+
+int main(int argc, char* argv[]) {
+    int refsPerCore = argc > 1 ? std::atoi(argv[1]) : 200000;
+    if (refsPerCore <= 0) {
+        std::cout << "Usage: ./bench_cores [refs-per-core]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::setw(6) << "cores" << std::setw(12) << "refs" << std::setw(10) << "seconds"
+              << std::setw(14) << "refs/s" << std::setw(10) << "ns/ref" << std::endl;
+    for (int numCores = 1; numCores <= 64; numCores *= 2) {
+        std::vector<std::vector<TraceRecord> > generated = makeTraces(numCores, refsPerCore);
+        TraceSet traces("bench", generated);
+        CacheSimulator simulator(traces, 6, 2, 5, "", false);
+
+        auto start = std::chrono::steady_clock::now();
+        simulator.simulate();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double refs = (double)traces.getReferenceCount();
+        std::cout << std::setw(6) << numCores << std::setw(12) << (uint64_t)refs
+                  << std::setw(10) << std::fixed << std::setprecision(3) << seconds
+                  << std::setw(14) << std::setprecision(0) << refs / seconds
+                  << std::setw(10) << std::setprecision(1) << seconds * 1e9 / refs << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+// Prints the binary event records written by L1simulate --events as text,
+// one event per line, in the same format as -d.
+#include "EventTrace.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Usage: ./decode_events <events file>" << std::endl;
+        return 1;
+    }
+
+    std::FILE* in = std::fopen(argv[1], "rb");
+    if (!in) {
+        std::cerr << "Error: cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    EventFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, in) != 1 || std::memcmp(header.magic, "L1EV", 4) != 0 ||
+        header.version != EVENT_FORMAT_VERSION || header.eventSize != sizeof(TraceEvent)) {
+        std::cerr << "Error: " << argv[1] << " is not an event trace" << std::endl;
+        std::fclose(in);
+        return 1;
+    }
+
+    TraceEvent events[4096];
+    size_t n;
+    while ((n = std::fread(events, sizeof(TraceEvent), 4096, in)) > 0) {
+        for (size_t i = 0; i < n; i++) std::cout << formatTraceEvent(events[i]) << '\n';
+    }
+    std::fclose(in);
+    return 0;
+}
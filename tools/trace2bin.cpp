@@ -0,0 +1,41 @@
+// Converts "R 0x..." text traces into the fixed-width binary trace format
+// read by L1simulate. Each appN_procK.trace argument is written next to the
+// input as appN_procK.bin, which the -t prefix lookup then prefers.
+#include "TraceReader.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+static int coreIdFromPath(const std::string& path) {
+    size_t pos = path.rfind("_proc");
+    if (pos == std::string::npos) return 0;
+    return std::atoi(path.c_str() + pos + 5);
+}
+
+static std::string binPathFor(const std::string& path) {
+    const std::string ext = ".trace";
+    if (path.size() > ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0) {
+        return path.substr(0, path.size() - ext.size()) + ".bin";
+    }
+    return path + ".bin";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: ./trace2bin <appN_procK.trace>..." << std::endl;
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        std::string in = argv[i];
+        std::string out = binPathFor(in);
+        try {
+            uint64_t records = convertTextTrace(in, out, coreIdFromPath(in));
+            std::cout << in << " -> " << out << " (" << records << " records)" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,215 @@
+// Generates synthetic <prefix>_procK trace sets with parameterised access
+// patterns, in the text or binary format.
+//
+//   tracegen -o traces/app1 -n 8 -r 1000000 -p stream:2,producer-consumer,false-sharing
+//
+// Each core's trace is cut into fixed-size chunks that worker threads
+// generate and write at their final offsets (text lines are fixed width),
+// so the output depends only on the options and --seed, never on -j.
+#include "SyntheticTrace.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t TEXT_RECORD_BYTES = 13;  // "R 0x01234567\n"
+
+static void printUsage() {
+    std::cout << "Usage: ./tracegen -o <prefix> -n <cores> -r <refs-per-core> [options]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -p <pattern[:weight],...>: mix of access patterns (default: random), out of" << std::endl;
+    std::cout << "      stream, random, producer-consumer, migratory, true-sharing, false-sharing, read-mostly" << std::endl;
+    std::cout << "  --format <text|bin>: output format (default: bin)" << std::endl;
+    std::cout << "  --footprint <bytes>: private region, producer buffer and shared table size (default: 1M)" << std::endl;
+    std::cout << "  --stride <bytes>: stream stride (default: 4)" << std::endl;
+    std::cout << "  --block <bytes>: block size the sharing patterns are laid out for (default: 64)" << std::endl;
+    std::cout << "  --phase <refs>: producer-consumer lag and migratory turn length (default: 1024)" << std::endl;
+    std::cout << "  --write-ratio <f>: writes among stream, random and sharing references (default: 0.3)" << std::endl;
+    std::cout << "  --table-write-ratio <f>: writes among read-mostly references (default: 0.01)" << std::endl;
+    std::cout << "  --seed <n>: random seed (default: 1)" << std::endl;
+    std::cout << "  -j <threads>: generator threads (default: all hardware threads)" << std::endl;
+    std::cout << "Sizes and counts accept K, M and G suffixes (powers of 1024 for sizes, 1000 for counts)." << std::endl;
+}
+
+// "64", "1M", "1e9"; multiplier is 1024 for sizes and 1000 for counts
+static uint64_t parseAmount(const std::string& text, uint64_t multiplier) {
+    char* end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    if (end == text.c_str()) throw std::runtime_error("bad number: " + text);
+    if (*end == 'K' || *end == 'k') value *= multiplier, end++;
+    else if (*end == 'M' || *end == 'm') value *= (double)multiplier * multiplier, end++;
+    else if (*end == 'G' || *end == 'g') value *= (double)multiplier * multiplier * multiplier, end++;
+    if (*end != '\0' || value < 0) throw std::runtime_error("bad number: " + text);
+    return (uint64_t)value;
+}
+
+static std::vector<std::pair<TracePattern, double> > parseMix(const std::string& spec) {
+    std::vector<std::pair<TracePattern, double> > mix;
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t colon = item.find(':');
+        std::string name = item.substr(0, colon);
+        TracePattern pattern = patternFromName(name);
+        if (pattern == PATTERN_COUNT) throw std::runtime_error("unknown pattern: " + name);
+        double weight = colon == std::string::npos ? 1.0 : std::atof(item.c_str() + colon + 1);
+        mix.push_back(std::make_pair(pattern, weight));
+    }
+    if (mix.empty()) throw std::runtime_error("empty pattern list");
+    return mix;
+}
+
+static inline size_t formatText(const TraceRecord* records, size_t count, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    char* p = out;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t address = (uint32_t)(records[i].word >> 1);
+        p[0] = records[i].op() == WRITE ? 'W' : 'R';
+        p[1] = ' ';
+        p[2] = '0';
+        p[3] = 'x';
+        for (int d = 0; d < 8; d++) p[4 + d] = digits[(address >> (28 - 4 * d)) & 0xf];
+        p[12] = '\n';
+        p += TEXT_RECORD_BYTES;
+    }
+    return p - out;
+}
+
+static void writeAll(int fd, const void* data, size_t size, off_t offset, const std::string& path) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, offset);
+        if (n <= 0) throw std::runtime_error("failed writing trace: " + path);
+        p += n;
+        size -= n;
+        offset += n;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    SyntheticTraceOptions options;
+    options.mix.push_back(std::make_pair(PATTERN_RANDOM, 1.0));
+    std::string prefix;
+    bool text = false;
+    int threads = (int)std::thread::hardware_concurrency();
+    bool haveCores = false, haveRefs = false;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc || arg == "-h") {
+                printUsage();
+                return arg == "-h" ? 0 : 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "-o") prefix = value;
+            else if (arg == "-n") options.numCores = (int)parseAmount(value, 1000), haveCores = true;
+            else if (arg == "-r") options.refsPerCore = parseAmount(value, 1000), haveRefs = true;
+            else if (arg == "-p") options.mix = parseMix(value);
+            else if (arg == "--format" && (value == "text" || value == "bin")) text = value == "text";
+            else if (arg == "--footprint") options.footprint = parseAmount(value, 1024);
+            else if (arg == "--stride") options.stride = (uint32_t)parseAmount(value, 1024);
+            else if (arg == "--block") options.blockSize = (uint32_t)parseAmount(value, 1024);
+            else if (arg == "--phase") options.phase = parseAmount(value, 1000);
+            else if (arg == "--write-ratio") options.writeRatio = std::atof(value.c_str());
+            else if (arg == "--table-write-ratio") options.tableWriteRatio = std::atof(value.c_str());
+            else if (arg == "--seed") options.seed = std::strtoull(value.c_str(), nullptr, 0);
+            else if (arg == "-j") threads = std::atoi(value.c_str());
+            else {
+                printUsage();
+                return 1;
+            }
+        }
+        if (prefix.empty() || !haveCores || !haveRefs) {
+            printUsage();
+            return 1;
+        }
+        if (threads <= 0) threads = 1;
+
+        SyntheticTrace generator(options);
+        const char* extension = text ? ".trace" : ".bin";
+        size_t headerBytes = text ? 0 : sizeof(TraceFileHeader);
+        size_t recordBytes = text ? TEXT_RECORD_BYTES : sizeof(TraceRecord);
+
+        std::vector<int> fds(options.numCores, -1);
+        std::vector<std::string> paths(options.numCores);
+        for (int core = 0; core < options.numCores; core++) {
+            paths[core] = prefix + "_proc" + std::to_string(core) + extension;
+            fds[core] = ::open(paths[core].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fds[core] < 0) throw std::runtime_error("cannot create trace: " + paths[core]);
+            if (!text) {
+                TraceFileHeader header = makeTraceHeader(core, options.refsPerCore);
+                writeAll(fds[core], &header, sizeof(header), 0, paths[core]);
+            }
+            if (ftruncate(fds[core], headerBytes + options.refsPerCore * recordBytes) != 0) {
+                throw std::runtime_error("cannot size trace: " + paths[core]);
+            }
+            // -t prefers .bin, then .ctr, over .trace: an older one would hide this trace
+            std::string base = prefix + "_proc" + std::to_string(core);
+            struct stat st;
+            for (const char* other : { ".bin", ".ctr" }) {
+                if (other != std::string(extension) && stat((base + other).c_str(), &st) == 0) {
+                    std::cerr << "Warning: " << base << other << " exists and will be read instead of "
+                              << paths[core] << std::endl;
+                }
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t chunks = generator.chunksPerCore();
+        uint64_t jobs = chunks * options.numCores;
+        std::atomic<uint64_t> nextJob(0);
+        std::atomic<bool> failed(false);
+        std::string error;
+        auto worker = [&]() {
+            std::vector<TraceRecord> records(SYNTHETIC_CHUNK_RECORDS);
+            std::vector<char> buffer(text ? SYNTHETIC_CHUNK_RECORDS * TEXT_RECORD_BYTES : 0);
+            for (uint64_t job = nextJob++; job < jobs && !failed; job = nextJob++) {
+                int core = (int)(job % options.numCores);
+                uint64_t chunk = job / options.numCores;
+                size_t count = generator.generate(core, chunk, records.data());
+                off_t offset = headerBytes + chunk * SYNTHETIC_CHUNK_RECORDS * recordBytes;
+                try {
+                    if (text) {
+                        size_t bytes = formatText(records.data(), count, buffer.data());
+                        writeAll(fds[core], buffer.data(), bytes, offset, paths[core]);
+                    } else {
+                        writeAll(fds[core], records.data(), count * sizeof(TraceRecord), offset, paths[core]);
+                    }
+                } catch (const std::exception& e) {
+                    if (!failed.exchange(true)) error = e.what();
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads && (uint64_t)t < jobs; t++) pool.push_back(std::thread(worker));
+        worker();
+        for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+        for (int core = 0; core < options.numCores; core++) {
+            if (::close(fds[core]) != 0 && !failed) {
+                failed = true;
+                error = "failed writing trace: " + paths[core];
+            }
+        }
+        if (failed) throw std::runtime_error(error);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t total = options.refsPerCore * options.numCores;
+        std::cout << "Wrote " << options.numCores << " traces " << prefix << "_proc*" << extension << " ("
+                  << total << " references, " << seconds << " s, "
+                  << (uint64_t)(seconds > 0 ? total / seconds : 0) << " refs/s)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
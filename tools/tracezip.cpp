@@ -0,0 +1,70 @@
+// Converts traces to and from the compressed (.ctr) trace format.
+//   tracezip appN_procK.trace...   writes appN_procK.ctr next to each input
+//                                  (text or .bin), which -t then picks up
+//   tracezip -x appN_procK.ctr     prints the trace as "R 0x..." text
+#include "CompressedTrace.h"
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static int coreIdFromPath(const std::string& path) {
+    int coreId = 0;
+    tracePrefixOf(path, &coreId);
+    return coreId;
+}
+
+static std::string ctrPathFor(const std::string& path) {
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + ".ctr";
+    return path.substr(0, dot) + ".ctr";
+}
+
+static long long fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long long)st.st_size : 0;
+}
+
+static void printText(const std::string& path) {
+    std::unique_ptr<TraceReader> reader = TraceReader::open(path);
+    TraceRecord record;
+    char line[32];
+    while (reader->next(record)) {
+        int n = std::snprintf(line, sizeof(line), "%c 0x%llx\n", record.op() == WRITE ? 'W' : 'R',
+                              (unsigned long long)(record.word >> 1));
+        std::fwrite(line, 1, n, stdout);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool extract = argc > 1 && std::strcmp(argv[1], "-x") == 0;
+    int first = extract ? 2 : 1;
+    if (argc <= first) {
+        std::cout << "Usage: ./tracezip <appN_procK.trace|.bin>...   (compress)" << std::endl;
+        std::cout << "       ./tracezip -x <appN_procK.ctr>          (print as text)" << std::endl;
+        return 1;
+    }
+
+    for (int i = first; i < argc; i++) {
+        std::string in = argv[i];
+        try {
+            if (extract) {
+                printText(in);
+                continue;
+            }
+            std::string out = ctrPathFor(in);
+            uint64_t records = compressTrace(in, out, coreIdFromPath(in));
+            long long inBytes = fileSize(in), outBytes = fileSize(out);
+            std::cout << in << " -> " << out << " (" << records << " records, " << inBytes << " -> "
+                      << outBytes << " bytes, " << (outBytes > 0 ? (double)inBytes / outBytes : 0.0)
+                      << "x)" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}